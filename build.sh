@@ -13,8 +13,31 @@ src=(
 )
 
 cimgui_flags="-L./vendor/cimgui -lcimgui -I./vendor/cimgui"
-sokol_flags="-L./build -lsokol -I./vendor/sokol -I./vendor/sokol/util"
-compile_flags="-o ./build/imdraw -framework QuartzCore -framework Cocoa -framework MetalKit -framework Metal"
+sokol_lib="sokol"
+
+if [ "$(uname -s)" = "Darwin" ]; then
+	defines=""
+	sokol_lang="objective-c"
+	output="./build/imdraw"
+	link_flags="-framework QuartzCore -framework Cocoa -framework MetalKit -framework Metal"
+elif [ "${1:-}" = "--gl" ]; then
+	# windowed build on opengl 4.1. without a gpu, it runs on mesa's software
+	# rasterizer with LIBGL_ALWAYS_SOFTWARE=1.
+	defines=""
+	sokol_lang="c"
+	output="./build/imdraw"
+	link_flags="-lX11 -lXi -lXcursor -lGL -ldl -lstdc++ -lm -lpthread"
+else
+	# everywhere else, build the headless benchmark binary.
+	# it runs on sokol's dummy backend, so it needs neither a window nor a gpu.
+	defines="-DIMDRAW_HEADLESS"
+	sokol_lang="c"
+	output="./build/imdraw-bench"
+	link_flags="-lstdc++ -lm -lpthread"
+	sokol_lib="sokol-headless"
+fi
+
+sokol_flags="-L./build -l$sokol_lib -I./vendor/sokol -I./vendor/sokol/util"
 
 mkdir -p build/
 
@@ -30,20 +53,21 @@ else
 fi
 
 # compile sokol into a static library
-if [ ! -f build/libsokol.a ]; then
+if [ ! -f build/lib$sokol_lib.a ]; then
 	echo "Compiling Sokol..."
-	$CC -c -x objective-c lib/sokol.c -o build/sokol.o $cimgui_flags $sokol_flags
-	$AR rcs build/libsokol.a build/sokol.o
+	$CC -c -x $sokol_lang $defines lib/sokol.c -o build/sokol.o $cimgui_flags $sokol_flags
+	$AR rcs build/lib$sokol_lib.a build/sokol.o
 	rm build/sokol.o
 	echo "Sokol compiled!"
 else
-	echo "libsokol.a exists, skipping compilation!"
+	echo "lib$sokol_lib.a exists, skipping compilation!"
 fi
 
-compile_cmd="$CC $src $compile_flags $cimgui_flags $sokol_flags"
+# sokol depends on cimgui, so it has to come first for linkers that resolve
+# static libraries in order.
+compile_cmd="$CC $defines ${src[@]} -o $output $sokol_flags $cimgui_flags $link_flags"
 
 echo $compile_cmd
 $compile_cmd
 
 popd >> /dev/null
-
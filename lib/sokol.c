@@ -1,6 +1,10 @@
 // sokol implementation library on non-Apple platforms
 #define SOKOL_IMPL
-#if defined(__MINGW32__)
+#if defined(IMDRAW_HEADLESS)
+// headless benchmark builds have no window and render nothing
+#define SOKOL_DUMMY_BACKEND
+#define SOKOL_IMGUI_NO_SOKOL_APP
+#elif defined(__MINGW32__)
 #define SOKOL_GLCORE
 #elif defined(_WIN32)
 #define SOKOL_D3D11
@@ -12,9 +16,13 @@
 #else
 #define SOKOL_GLCORE
 #endif
+#if !defined(IMDRAW_HEADLESS)
 #include "sokol_app.h"
+#endif
 #include "sokol_gfx.h"
+#if !defined(IMDRAW_HEADLESS)
 #include "sokol_glue.h"
+#endif
 #include "sokol_log.h"
 #define CIMGUI_DEFINE_ENUMS_AND_STRUCTS
 #include "cimgui.h"
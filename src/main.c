@@ -1,13 +1,31 @@
 #define CIMGUI_DEFINE_ENUMS_AND_STRUCTS
+#if defined(IMDRAW_HEADLESS)
+#define SOKOL_DUMMY_BACKEND
+// there is no sokol_app in headless builds, so sokol_imgui is fed frames and
+// input by hand
+#define SOKOL_IMGUI_NO_SOKOL_APP
+#elif defined(__APPLE__)
 #define SOKOL_METAL
+#else
+#define SOKOL_GLCORE
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#define IMDRAW_X86
+#endif
 
 #include "cimgui.h"
 #include "fa_regular_400.h"
+#if !defined(IMDRAW_HEADLESS)
 #include "sokol_app.h"
+#endif
 #include "sokol_gfx.h"
+#if !defined(IMDRAW_HEADLESS)
 #include "sokol_glue.h"
+#endif
 #include "sokol_imgui.h"
 #include "sokol_log.h"
+#include <float.h>
 #include <math.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -15,6 +33,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#if defined(IMDRAW_X86)
+#include <immintrin.h>
+#endif
 
 // if mouse movement between mouse down and mouse up is below this threshold (in
 // px) then it is considered to be a mouse click
@@ -24,7 +45,128 @@
 // threshold then the entity is considered to be selected
 #define SELECT_THRESHOLD 25
 
-#define ARENA_INITIAL_SIZE 5000
+// alignment of arena_push, enough for any type
+#define ARENA_DEFAULT_ALIGNMENT 16
+
+// thickness (in px) of path strokes
+#define PATH_THICKNESS 2
+
+// radius (in px) of the handles drawn on the ends of selected paths
+#define SELECTION_HANDLE_RADIUS 4
+
+// entities are culled against the viewport grown by this margin (in px). it
+// covers the selection handles and strokes that stick out of their bounds,
+// plus the 1 px antialiasing fringe of the canvas renderer.
+#define CULL_MARGIN (SELECTION_HANDLE_RADIUS + PATH_THICKNESS / 2.0f + 1)
+
+// default distance (in px) that simplified strokes may deviate from the points
+// that were drawn
+#define STROKE_SIMPLIFY_TOLERANCE 0.75f
+
+// capacity (in points) of a chunk of the list that the draw tool records a
+// stroke into
+#define STROKE_CHUNK_CAPACITY 1024
+
+// capacity (in points) of the smallest size class of the point pool. freed
+// buffers hold the next buffer of their free list, so it must fit a pointer.
+#define POINT_POOL_MIN_CAPACITY 4
+
+// number of size classes of the point pool. class i holds buffers of
+// POINT_POOL_MIN_CAPACITY << i points, and larger buffers are allocated on
+// their own.
+#define POINT_POOL_CLASS_COUNT 16
+
+// size (in bytes) of a slab that the point pool carves buffers out of
+#define POINT_POOL_SLAB_SIZE (256 * 1024)
+
+// capacity (in bytes) of the span a new text entity gets in the text pool
+#define TEXT_INITIAL_CAPACITY 64
+
+// size (in bytes) of a page of the frame arenas
+#define FRAME_ARENA_PAGE_SIZE (64 * 1024)
+
+// initial capacity (in instances) of the vertex buffers of the canvas renderer
+#define CANVAS_BUFFER_INITIAL_CAPACITY 4096
+
+// culled entities whose instances add up to fewer than this are drawn anyway,
+// and left for the gpu to clip, rather than splitting the draw around them
+#define CANVAS_CULL_MIN_GAP 256
+
+// name of the window shown by igShowMetricsWindow, so that canvas stats can be
+// appended to it
+#define METRICS_WINDOW_NAME "Dear ImGui Metrics/Debugger"
+
+// size (in px) of a cell of the spatial grid used for hit testing
+#define GRID_CELL_SIZE 128
+
+// number of hash buckets the grid cells are distributed into. must be a power
+// of two.
+#define GRID_BUCKET_COUNT 4096
+
+// entities covering more grid cells than this are kept in a separate list that
+// is always tested, instead of being copied into every cell they cover
+#define GRID_MAX_CELLS_PER_ENTITY 64
+
+// cell indices of the grid stay within -GRID_MAX_CELL_INDEX and
+// GRID_MAX_CELL_INDEX, so that they fit an int and so does their difference
+#define GRID_MAX_CELL_INDEX (1 << 29)
+
+// maximum number of entities in a leaf of the bvh used for area selection
+#define BVH_LEAF_SIZE 4
+
+// the bvh is split at the median, so its depth is at most log2(entity count)
+#define BVH_MAX_DEPTH 64
+
+// number of consecutive segments of a path covered by a leaf of its segment
+// tree. hit tests scan the segments of a leaf with the simd kernels.
+#define SEGMENT_RUN_LENGTH 32
+
+// each level of a segment tree halves the number of nodes, starting from at
+// most UINT32_MAX leaves
+#define SEGMENT_TREE_MAX_LEVELS 33
+
+// ============================================================================
+// heap allocation
+// ============================================================================
+
+// every heap allocation goes through these, so that they can be counted.
+// reallocations count as allocations, since they may allocate.
+
+typedef struct {
+  size_t count;
+  size_t bytes;
+} alloc_counter_t;
+
+// allocations made since the program started
+static alloc_counter_t total_allocs;
+
+void *mem_alloc(size_t size) {
+  ++total_allocs.count;
+  total_allocs.bytes += size;
+  return malloc(size);
+}
+
+void *mem_calloc(size_t count, size_t size) {
+  ++total_allocs.count;
+  total_allocs.bytes += count * size;
+  return calloc(count, size);
+}
+
+void *mem_realloc(void *ptr, size_t size) {
+  ++total_allocs.count;
+  total_allocs.bytes += size;
+  return realloc(ptr, size);
+}
+
+void mem_free(void *ptr) { free(ptr); }
+
+// returns the allocations made since since was taken from total_allocs
+alloc_counter_t allocs_since(const alloc_counter_t *since) {
+  return (alloc_counter_t){
+      .count = total_allocs.count - since->count,
+      .bytes = total_allocs.bytes - since->bytes,
+  };
+}
 
 // ============================================================================
 // utils/helpers
@@ -103,6 +245,99 @@ bool vec2_is_in_area(const ImVec2 *vec, const ImVec2 *point_a,
           b_to_vec_delta_y >= 0 && a_to_vec_delta_y <= 0);
 }
 
+// axis aligned bounding box
+typedef struct {
+  ImVec2 min;
+  ImVec2 max;
+} aabb_t;
+
+aabb_t aabb_from_points(const ImVec2 *points, size_t count) {
+  aabb_t aabb = {{INFINITY, INFINITY}, {-INFINITY, -INFINITY}};
+  for (size_t i = 0; i < count; ++i) {
+    aabb.min.x = fminf(aabb.min.x, points[i].x);
+    aabb.min.y = fminf(aabb.min.y, points[i].y);
+    aabb.max.x = fmaxf(aabb.max.x, points[i].x);
+    aabb.max.y = fmaxf(aabb.max.y, points[i].y);
+  }
+  return aabb;
+}
+
+// returns the aabb spanned by two opposite corners in any order
+aabb_t aabb_from_corners(const ImVec2 *point_a, const ImVec2 *point_b) {
+  return (aabb_t){
+      {fminf(point_a->x, point_b->x), fminf(point_a->y, point_b->y)},
+      {fmaxf(point_a->x, point_b->x), fmaxf(point_a->y, point_b->y)},
+  };
+}
+
+bool aabb_contains_point(const aabb_t *aabb, const ImVec2 *point,
+                         float margin) {
+  return point->x >= aabb->min.x - margin && point->x <= aabb->max.x + margin &&
+         point->y >= aabb->min.y - margin && point->y <= aabb->max.y + margin;
+}
+
+bool aabb_intersects(const aabb_t *a, const aabb_t *b) {
+  return a->min.x <= b->max.x && a->max.x >= b->min.x &&
+         a->min.y <= b->max.y && a->max.y >= b->min.y;
+}
+
+// returns whether inner is entirely inside outer
+bool aabb_contains(const aabb_t *outer, const aabb_t *inner) {
+  return inner->min.x >= outer->min.x && inner->max.x <= outer->max.x &&
+         inner->min.y >= outer->min.y && inner->max.y <= outer->max.y;
+}
+
+// returns the squared distance from point to the nearest point of aabb, which
+// is 0 if point is inside it
+float aabb_distance_sqr(const aabb_t *aabb, const ImVec2 *point) {
+  const float dx = fmaxf(fmaxf(aabb->min.x - point->x, 0),
+                         point->x - aabb->max.x);
+  const float dy = fmaxf(fmaxf(aabb->min.y - point->y, 0),
+                         point->y - aabb->max.y);
+  return dx * dx + dy * dy;
+}
+
+void aabb_move(aabb_t *aabb, const ImVec2 *delta) {
+  vec2_move(&aabb->min, delta);
+  vec2_move(&aabb->max, delta);
+}
+
+void aabb_union(aabb_t *aabb, const aabb_t *other) {
+  aabb->min.x = fminf(aabb->min.x, other->min.x);
+  aabb->min.y = fminf(aabb->min.y, other->min.y);
+  aabb->max.x = fmaxf(aabb->max.x, other->max.x);
+  aabb->max.y = fmaxf(aabb->max.y, other->max.y);
+}
+
+// covers the part of a outside of b with at most 4 aabbs, written to out, and
+// returns how many. the aabbs touch b along its borders, so they cover a little
+// more than a - b.
+size_t aabb_subtract(const aabb_t *a, const aabb_t *b, aabb_t out[4]) {
+  if (!aabb_intersects(a, b)) {
+    out[0] = *a;
+    return 1;
+  }
+
+  size_t count = 0;
+  // strips above and below b, as wide as a, then strips left and right of b
+  // between them
+  if (a->min.y < b->min.y) {
+    out[count++] = (aabb_t){a->min, {a->max.x, b->min.y}};
+  }
+  if (a->max.y > b->max.y) {
+    out[count++] = (aabb_t){{a->min.x, b->max.y}, a->max};
+  }
+  const float min_y = fmaxf(a->min.y, b->min.y);
+  const float max_y = fminf(a->max.y, b->max.y);
+  if (a->min.x < b->min.x) {
+    out[count++] = (aabb_t){{a->min.x, min_y}, {b->min.x, max_y}};
+  }
+  if (a->max.x > b->max.x) {
+    out[count++] = (aabb_t){{b->max.x, min_y}, {a->max.x, max_y}};
+  }
+  return count;
+}
+
 bool is_mouse_click(const ImVec2 *mouse_down_pos, const ImVec2 *mouse_up_pos) {
   if (igIsMouseReleased_Nil(ImGuiMouseButton_Left)) {
     return vec2_distance_sqr(mouse_up_pos, mouse_down_pos) <= CLICK_THRESHOLD;
@@ -110,6 +345,364 @@ bool is_mouse_click(const ImVec2 *mouse_down_pos, const ImVec2 *mouse_up_pos) {
   return false;
 }
 
+// ============================================================================
+// simd kernels
+// ============================================================================
+
+// kernels over runs of points, in a scalar version and, on x86, in sse2 and
+// avx2 versions. the versions compute the same thing, and the best one the cpu
+// supports is picked at runtime, so that the binary does not need to be built
+// for a particular cpu.
+
+typedef enum {
+  simd_level_scalar,
+  simd_level_sse2,
+  simd_level_avx2,
+} simd_level_t;
+
+static const char *simd_level_names[] = {"scalar", "sse2", "avx2"};
+
+// returns the best instruction set supported by the cpu
+simd_level_t simd_level(void) {
+  static int level = -1;
+  if (level < 0) {
+    level = simd_level_scalar;
+#if defined(IMDRAW_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      level = simd_level_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+      level = simd_level_sse2;
+    }
+#endif
+  }
+  return level;
+}
+
+// squared distance from the point (px, py) to the segment a-b, where
+// (ax, ay) = point - a and (bx, by) = b - a. the point is projected onto the
+// segment without branches: the projection is clamped to the segment, and
+// degenerate segments project onto a.
+static inline float segment_distance_sqr(float ax, float ay, float bx,
+                                         float by) {
+  // plain comparisons rather than fminf and fmaxf, which are library calls
+  // unless nans can be ruled out
+  const float b_dot_b = bx * bx + by * by;
+  float a_dot_b = ax * bx + ay * by;
+  a_dot_b = a_dot_b > 0 ? a_dot_b : 0;
+  a_dot_b = a_dot_b < b_dot_b ? a_dot_b : b_dot_b;
+  const float t = a_dot_b / (b_dot_b > FLT_MIN ? b_dot_b : FLT_MIN);
+  const float dx = ax - t * bx;
+  const float dy = ay - t * by;
+  return dx * dx + dy * dy;
+}
+
+// returns the smallest squared distance from point to the segment_count
+// segments between consecutive points, which holds segment_count + 1 points,
+// or INFINITY if there are none. stops early once a distance of at most
+// stop_distance_sqr is found, in which case the result is only known to be at
+// most stop_distance_sqr.
+float segments_distance_sqr_scalar(const ImVec2 *points, size_t segment_count,
+                                   const ImVec2 *point,
+                                   float stop_distance_sqr) {
+  float min_distance_sqr = INFINITY;
+  for (size_t i = 0; i < segment_count; ++i) {
+    const float distance_sqr = segment_distance_sqr(
+        point->x - points[i].x, point->y - points[i].y,
+        points[i + 1].x - points[i].x, points[i + 1].y - points[i].y);
+    if (distance_sqr < min_distance_sqr) {
+      min_distance_sqr = distance_sqr;
+    }
+    if (min_distance_sqr <= stop_distance_sqr) {
+      break;
+    }
+  }
+  return min_distance_sqr;
+}
+
+// returns whether any of the count points is inside area, borders included
+bool points_any_in_area_scalar(const ImVec2 *points, size_t count,
+                               const aabb_t *area) {
+  for (size_t i = 0; i < count; ++i) {
+    if (points[i].x >= area->min.x && points[i].x <= area->max.x &&
+        points[i].y >= area->min.y && points[i].y <= area->max.y) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// adds delta to each of the count points
+void points_translate_scalar(ImVec2 *points, size_t count,
+                             const ImVec2 *delta) {
+  for (size_t i = 0; i < count; ++i) {
+    points[i].x += delta->x;
+    points[i].y += delta->y;
+  }
+}
+
+#if defined(IMDRAW_X86)
+
+__attribute__((target("sse2"))) static inline float
+simd_min_sse2(__m128 v) {
+  v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+  v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtss_f32(v);
+}
+
+// segments_distance_sqr_scalar, 4 segments at a time
+__attribute__((target("sse2"))) float
+segments_distance_sqr_sse2(const ImVec2 *points, size_t segment_count,
+                           const ImVec2 *point, float stop_distance_sqr) {
+  const __m128 px = _mm_set1_ps(point->x);
+  const __m128 py = _mm_set1_ps(point->y);
+  const __m128 stop = _mm_set1_ps(stop_distance_sqr);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 min_b_dot_b = _mm_set1_ps(FLT_MIN);
+  __m128 min_distance_sqr = _mm_set1_ps(INFINITY);
+
+  size_t i = 0;
+  for (; i + 4 <= segment_count; i += 4) {
+    // the starts and ends of 4 segments, split into their x and y
+    const float *start = &points[i].x;
+    const __m128 start_lo = _mm_loadu_ps(start);
+    const __m128 start_hi = _mm_loadu_ps(start + 4);
+    const __m128 end_lo = _mm_loadu_ps(start + 2);
+    const __m128 end_hi = _mm_loadu_ps(start + 6);
+    const __m128 x1 = _mm_shuffle_ps(start_lo, start_hi, 0x88);
+    const __m128 y1 = _mm_shuffle_ps(start_lo, start_hi, 0xdd);
+    const __m128 x2 = _mm_shuffle_ps(end_lo, end_hi, 0x88);
+    const __m128 y2 = _mm_shuffle_ps(end_lo, end_hi, 0xdd);
+
+    const __m128 ax = _mm_sub_ps(px, x1);
+    const __m128 ay = _mm_sub_ps(py, y1);
+    const __m128 bx = _mm_sub_ps(x2, x1);
+    const __m128 by = _mm_sub_ps(y2, y1);
+
+    const __m128 b_dot_b = _mm_add_ps(_mm_mul_ps(bx, bx), _mm_mul_ps(by, by));
+    __m128 a_dot_b = _mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by));
+    a_dot_b = _mm_min_ps(_mm_max_ps(a_dot_b, zero), b_dot_b);
+    const __m128 t = _mm_div_ps(a_dot_b, _mm_max_ps(b_dot_b, min_b_dot_b));
+    const __m128 dx = _mm_sub_ps(ax, _mm_mul_ps(t, bx));
+    const __m128 dy = _mm_sub_ps(ay, _mm_mul_ps(t, by));
+    const __m128 distance_sqr =
+        _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+
+    min_distance_sqr = _mm_min_ps(min_distance_sqr, distance_sqr);
+    if (_mm_movemask_ps(_mm_cmple_ps(distance_sqr, stop)) != 0) {
+      return simd_min_sse2(min_distance_sqr);
+    }
+  }
+
+  const float rest = segments_distance_sqr_scalar(
+      points + i, segment_count - i, point, stop_distance_sqr);
+  return fminf(simd_min_sse2(min_distance_sqr), rest);
+}
+
+__attribute__((target("avx2"))) static inline float
+simd_min_avx2(__m256 v) {
+  return simd_min_sse2(_mm_min_ps(_mm256_castps256_ps128(v),
+                                  _mm256_extractf128_ps(v, 1)));
+}
+
+// segments_distance_sqr_scalar, 8 segments at a time. the points are split
+// into x and y within each 128 bit lane, which visits the segments out of
+// order, but the smallest distance does not depend on the order.
+__attribute__((target("avx2"))) float
+segments_distance_sqr_avx2(const ImVec2 *points, size_t segment_count,
+                           const ImVec2 *point, float stop_distance_sqr) {
+  const __m256 px = _mm256_set1_ps(point->x);
+  const __m256 py = _mm256_set1_ps(point->y);
+  const __m256 stop = _mm256_set1_ps(stop_distance_sqr);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 min_b_dot_b = _mm256_set1_ps(FLT_MIN);
+  __m256 min_distance_sqr = _mm256_set1_ps(INFINITY);
+
+  size_t i = 0;
+  for (; i + 8 <= segment_count; i += 8) {
+    const float *start = &points[i].x;
+    const __m256 start_lo = _mm256_loadu_ps(start);
+    const __m256 start_hi = _mm256_loadu_ps(start + 8);
+    const __m256 end_lo = _mm256_loadu_ps(start + 2);
+    const __m256 end_hi = _mm256_loadu_ps(start + 10);
+    const __m256 x1 = _mm256_shuffle_ps(start_lo, start_hi, 0x88);
+    const __m256 y1 = _mm256_shuffle_ps(start_lo, start_hi, 0xdd);
+    const __m256 x2 = _mm256_shuffle_ps(end_lo, end_hi, 0x88);
+    const __m256 y2 = _mm256_shuffle_ps(end_lo, end_hi, 0xdd);
+
+    const __m256 ax = _mm256_sub_ps(px, x1);
+    const __m256 ay = _mm256_sub_ps(py, y1);
+    const __m256 bx = _mm256_sub_ps(x2, x1);
+    const __m256 by = _mm256_sub_ps(y2, y1);
+
+    const __m256 b_dot_b =
+        _mm256_add_ps(_mm256_mul_ps(bx, bx), _mm256_mul_ps(by, by));
+    __m256 a_dot_b =
+        _mm256_add_ps(_mm256_mul_ps(ax, bx), _mm256_mul_ps(ay, by));
+    a_dot_b = _mm256_min_ps(_mm256_max_ps(a_dot_b, zero), b_dot_b);
+    const __m256 t =
+        _mm256_div_ps(a_dot_b, _mm256_max_ps(b_dot_b, min_b_dot_b));
+    const __m256 dx = _mm256_sub_ps(ax, _mm256_mul_ps(t, bx));
+    const __m256 dy = _mm256_sub_ps(ay, _mm256_mul_ps(t, by));
+    const __m256 distance_sqr =
+        _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+
+    min_distance_sqr = _mm256_min_ps(min_distance_sqr, distance_sqr);
+    if (_mm256_movemask_ps(_mm256_cmp_ps(distance_sqr, stop, _CMP_LE_OQ)) !=
+        0) {
+      return simd_min_avx2(min_distance_sqr);
+    }
+  }
+
+  const float rest = segments_distance_sqr_scalar(
+      points + i, segment_count - i, point, stop_distance_sqr);
+  return fminf(simd_min_avx2(min_distance_sqr), rest);
+}
+
+// points_any_in_area_scalar, 4 points at a time. points are compared as they
+// are laid out in memory, with x and y in alternate lanes, against the corners
+// of area repeated in the same layout. a point is inside if both its lanes are.
+__attribute__((target("sse2"))) bool
+points_any_in_area_sse2(const ImVec2 *points, size_t count,
+                        const aabb_t *area) {
+  const __m128 min =
+      _mm_setr_ps(area->min.x, area->min.y, area->min.x, area->min.y);
+  const __m128 max =
+      _mm_setr_ps(area->max.x, area->max.y, area->max.x, area->max.y);
+
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m128 lo = _mm_loadu_ps(&points[i].x);
+    const __m128 hi = _mm_loadu_ps(&points[i + 2].x);
+    const __m128 is_lo_in =
+        _mm_and_ps(_mm_cmpge_ps(lo, min), _mm_cmple_ps(lo, max));
+    const __m128 is_hi_in =
+        _mm_and_ps(_mm_cmpge_ps(hi, min), _mm_cmple_ps(hi, max));
+    // bit 2k is set if point k is inside on x, and bit 2k + 1 if it is on y
+    const int mask = _mm_movemask_ps(is_lo_in) | _mm_movemask_ps(is_hi_in) << 4;
+    if (mask & mask >> 1 & 0x55) {
+      return true;
+    }
+  }
+
+  return points_any_in_area_scalar(points + i, count - i, area);
+}
+
+// points_any_in_area_sse2, 8 points at a time
+__attribute__((target("avx2"))) bool
+points_any_in_area_avx2(const ImVec2 *points, size_t count,
+                        const aabb_t *area) {
+  const __m256 min = _mm256_setr_ps(area->min.x, area->min.y, area->min.x,
+                                    area->min.y, area->min.x, area->min.y,
+                                    area->min.x, area->min.y);
+  const __m256 max = _mm256_setr_ps(area->max.x, area->max.y, area->max.x,
+                                    area->max.y, area->max.x, area->max.y,
+                                    area->max.x, area->max.y);
+
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m256 lo = _mm256_loadu_ps(&points[i].x);
+    const __m256 hi = _mm256_loadu_ps(&points[i + 4].x);
+    const __m256 is_lo_in =
+        _mm256_and_ps(_mm256_cmp_ps(lo, min, _CMP_GE_OQ),
+                      _mm256_cmp_ps(lo, max, _CMP_LE_OQ));
+    const __m256 is_hi_in =
+        _mm256_and_ps(_mm256_cmp_ps(hi, min, _CMP_GE_OQ),
+                      _mm256_cmp_ps(hi, max, _CMP_LE_OQ));
+    const int mask =
+        _mm256_movemask_ps(is_lo_in) | _mm256_movemask_ps(is_hi_in) << 8;
+    if (mask & mask >> 1 & 0x5555) {
+      return true;
+    }
+  }
+
+  return points_any_in_area_scalar(points + i, count - i, area);
+}
+
+// points_translate_scalar, 4 points at a time, with delta repeated to match
+// the alternating x and y of the points
+__attribute__((target("sse2"))) void
+points_translate_sse2(ImVec2 *points, size_t count, const ImVec2 *delta) {
+  const __m128 d = _mm_setr_ps(delta->x, delta->y, delta->x, delta->y);
+
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    float *lo = &points[i].x;
+    float *hi = &points[i + 2].x;
+    _mm_storeu_ps(lo, _mm_add_ps(_mm_loadu_ps(lo), d));
+    _mm_storeu_ps(hi, _mm_add_ps(_mm_loadu_ps(hi), d));
+  }
+
+  points_translate_scalar(points + i, count - i, delta);
+}
+
+// points_translate_sse2, 8 points at a time
+__attribute__((target("avx2"))) void
+points_translate_avx2(ImVec2 *points, size_t count, const ImVec2 *delta) {
+  const __m256 d =
+      _mm256_setr_ps(delta->x, delta->y, delta->x, delta->y, delta->x,
+                     delta->y, delta->x, delta->y);
+
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    float *lo = &points[i].x;
+    float *hi = &points[i + 4].x;
+    _mm256_storeu_ps(lo, _mm256_add_ps(_mm256_loadu_ps(lo), d));
+    _mm256_storeu_ps(hi, _mm256_add_ps(_mm256_loadu_ps(hi), d));
+  }
+
+  points_translate_scalar(points + i, count - i, delta);
+}
+
+#endif
+
+float segments_distance_sqr(const ImVec2 *points, size_t segment_count,
+                            const ImVec2 *point, float stop_distance_sqr) {
+  switch (simd_level()) {
+#if defined(IMDRAW_X86)
+  case simd_level_avx2:
+    return segments_distance_sqr_avx2(points, segment_count, point,
+                                      stop_distance_sqr);
+  case simd_level_sse2:
+    return segments_distance_sqr_sse2(points, segment_count, point,
+                                      stop_distance_sqr);
+#endif
+  default:
+    return segments_distance_sqr_scalar(points, segment_count, point,
+                                        stop_distance_sqr);
+  }
+}
+
+bool points_any_in_area(const ImVec2 *points, size_t count,
+                        const aabb_t *area) {
+  switch (simd_level()) {
+#if defined(IMDRAW_X86)
+  case simd_level_avx2:
+    return points_any_in_area_avx2(points, count, area);
+  case simd_level_sse2:
+    return points_any_in_area_sse2(points, count, area);
+#endif
+  default:
+    return points_any_in_area_scalar(points, count, area);
+  }
+}
+
+void points_translate(ImVec2 *points, size_t count, const ImVec2 *delta) {
+  switch (simd_level()) {
+#if defined(IMDRAW_X86)
+  case simd_level_avx2:
+    points_translate_avx2(points, count, delta);
+    break;
+  case simd_level_sse2:
+    points_translate_sse2(points, count, delta);
+    break;
+#endif
+  default:
+    points_translate_scalar(points, count, delta);
+    break;
+  }
+}
+
 // ============================================================================
 // struct definitions
 // ============================================================================
@@ -118,50 +711,167 @@ bool is_mouse_click(const ImVec2 *mouse_down_pos, const ImVec2 *mouse_up_pos) {
 // struct: arena
 // ===========================
 
+// memory is pushed onto pages of page_size bytes, and released all at once by
+// rewinding to a mark taken earlier. rewound pages are kept for reuse instead
+// of being freed. requests that do not fit on an empty page get a page of
+// their own, which is freed when rewound.
+
 typedef struct arena_page {
-  void *data;
-  size_t end_ptr;
   struct arena_page *next;
+  size_t capacity;
+  size_t used;
+  // capacity bytes of data follow the header
 } arena_page_t;
 
 typedef struct {
+  size_t page_count;
+  size_t oversized_page_count;
+  // bytes of the pages in use and kept for reuse, excluding headers
+  size_t reserved_bytes;
+  // bytes pushed onto the pages in use, including alignment padding
+  size_t used_bytes;
+  size_t peak_used_bytes;
+  size_t push_count;
+} arena_stats_t;
+
+typedef struct {
+  // pages in use, most recent first
   arena_page_t *page;
-  size_t capacity;
+  // pages of page_size bytes kept for reuse
+  arena_page_t *free_pages;
+  size_t page_size;
+  arena_stats_t stats;
 } arena_t;
 
-arena_page_t *arena_new_page(size_t page_size) {
-  arena_page_t *new_page = malloc(sizeof(arena_page_t));
-  new_page->data = malloc(sizeof(char) * page_size);
-  new_page->next = NULL;
-  new_page->end_ptr = 0;
-  return new_page;
+// a point in the history of an arena that it can be rewound to
+typedef struct {
+  arena_page_t *page;
+  size_t used;
+} arena_mark_t;
+
+char *arena_page_data(arena_page_t *page) { return (char *)(page + 1); }
+
+arena_page_t *arena_new_page(arena_t *arena, size_t capacity) {
+  arena_page_t *page = mem_alloc(sizeof(arena_page_t) + capacity);
+  page->next = NULL;
+  page->capacity = capacity;
+  page->used = 0;
+
+  ++arena->stats.page_count;
+  if (capacity != arena->page_size) {
+    ++arena->stats.oversized_page_count;
+  }
+  arena->stats.reserved_bytes += capacity;
+
+  return page;
+}
+
+void arena_free_page(arena_t *arena, arena_page_t *page) {
+  --arena->stats.page_count;
+  if (page->capacity != arena->page_size) {
+    --arena->stats.oversized_page_count;
+  }
+  arena->stats.reserved_bytes -= page->capacity;
+  mem_free(page);
 }
 
-arena_t *arena_alloc(size_t size) {
-  arena_t *arena = malloc(sizeof(arena_t));
-  arena->page = arena_new_page(size);
-  arena->capacity = size;
+arena_t *arena_alloc(size_t page_size) {
+  arena_t *arena = mem_alloc(sizeof(arena_t));
+  *arena = (arena_t){.page_size = page_size};
   return arena;
 }
 
-void *arena_push(arena_t *arena, size_t size) {
-  if (arena->page->end_ptr + size >= arena->capacity) {
-    arena_page_t *new_page = arena_new_page(arena->capacity);
-    new_page->next = arena->page;
-    arena->page = new_page;
+// pushes size bytes aligned to align, which must be a power of two
+void *arena_push_aligned(arena_t *arena, size_t size, size_t align) {
+  arena_page_t *page = arena->page;
+  size_t padding = 0;
+  if (page != NULL) {
+    const uintptr_t end = (uintptr_t)(arena_page_data(page) + page->used);
+    padding = (align - (end & (align - 1))) & (align - 1);
+  }
+
+  if (page == NULL || page->used + padding + size > page->capacity) {
+    // page data follows a header of pointer alignment, so the worst case
+    // padding on a new page is align - 1
+    const size_t worst_case_size = size + align - 1;
+    if (worst_case_size > arena->page_size) {
+      page = arena_new_page(arena, worst_case_size);
+    } else if (arena->free_pages != NULL) {
+      page = arena->free_pages;
+      arena->free_pages = page->next;
+      page->used = 0;
+    } else {
+      page = arena_new_page(arena, arena->page_size);
+    }
+    page->next = arena->page;
+    arena->page = page;
+
+    const uintptr_t start = (uintptr_t)arena_page_data(page);
+    padding = (align - (start & (align - 1))) & (align - 1);
+  }
+
+  const size_t used_before = page->used;
+  void *ptr = arena_page_data(page) + page->used + padding;
+  page->used += padding + size;
+  if (page->capacity != arena->page_size) {
+    // nothing else goes onto an oversized page, so that it can be freed as
+    // soon as it is rewound
+    page->used = page->capacity;
+  }
+
+  arena_stats_t *stats = &arena->stats;
+  stats->used_bytes += page->used - used_before;
+  ++stats->push_count;
+  if (stats->used_bytes > stats->peak_used_bytes) {
+    stats->peak_used_bytes = stats->used_bytes;
   }
-  void *ptr = arena->page->data + arena->page->end_ptr;
-  arena->page->end_ptr += size;
+
   return ptr;
 }
 
+void *arena_push(arena_t *arena, size_t size) {
+  return arena_push_aligned(arena, size, ARENA_DEFAULT_ALIGNMENT);
+}
+
+arena_mark_t arena_mark(const arena_t *arena) {
+  return (arena_mark_t){
+      .page = arena->page,
+      .used = arena->page ? arena->page->used : 0,
+  };
+}
+
+// releases everything pushed since mark was taken
+void arena_rewind(arena_t *arena, arena_mark_t mark) {
+  while (arena->page != mark.page) {
+    arena_page_t *page = arena->page;
+    arena->page = page->next;
+    arena->stats.used_bytes -= page->used;
+
+    if (page->capacity == arena->page_size) {
+      page->next = arena->free_pages;
+      arena->free_pages = page;
+    } else {
+      arena_free_page(arena, page);
+    }
+  }
+
+  if (arena->page != NULL) {
+    arena->stats.used_bytes -= arena->page->used - mark.used;
+    arena->page->used = mark.used;
+  }
+}
+
+// releases everything in arena, keeping its pages for reuse
+void arena_reset(arena_t *arena) { arena_rewind(arena, (arena_mark_t){0}); }
+
 void arena_free(arena_t *arena) {
-  printf("arena_free\n");
-  for (arena_page_t *page = arena->page; page != NULL; page = page->next) {
-    free(page->data);
-    free(page);
+  arena_reset(arena);
+  while (arena->free_pages != NULL) {
+    arena_page_t *page = arena->free_pages;
+    arena->free_pages = page->next;
+    arena_free_page(arena, page);
   }
-  free(arena);
+  mem_free(arena);
 }
 
 // ===========================
@@ -175,7 +885,7 @@ typedef struct {
 } growable_string_t;
 
 growable_string_t growable_string_alloc(size_t capacity) {
-  char *data = malloc(sizeof(char) * capacity);
+  char *data = mem_alloc(sizeof(char) * capacity);
   return (growable_string_t){
       .data = data,
       .length = 0,
@@ -186,10 +896,45 @@ growable_string_t growable_string_alloc(size_t capacity) {
 void growable_string_grow(growable_string_t *str, size_t additional_bytes) {
   if (str->length + additional_bytes >= str->capacity) {
     str->capacity = str->capacity * 2 + additional_bytes;
-    str->data = realloc(str->data, sizeof(char) * str->capacity);
+    str->data = mem_realloc(str->data, sizeof(char) * str->capacity);
   }
 }
 
+void growable_string_free(growable_string_t *str) {
+  mem_free(str->data);
+  *str = (growable_string_t){0};
+}
+
+// ===========================
+// struct: text pool
+// ===========================
+
+// variable length text stored back to back in one string. text is edited in
+// place within a span of fixed capacity, and moved to a new span at the end
+// when it outgrows it. spans that are no longer used are garbage until the
+// pool is compacted.
+typedef struct {
+  growable_string_t storage;
+  size_t garbage;
+} text_pool_t;
+
+// returns the offset of a new span of capacity bytes, holding an empty string
+uint32_t text_pool_alloc(text_pool_t *pool, size_t capacity) {
+  growable_string_grow(&pool->storage, capacity);
+  const uint32_t offset = (uint32_t)pool->storage.length;
+  pool->storage.length += capacity;
+  pool->storage.data[offset] = '\0';
+  return offset;
+}
+
+char *text_pool_get(const text_pool_t *pool, uint32_t offset) {
+  return pool->storage.data + offset;
+}
+
+void text_pool_release(text_pool_t *pool, size_t capacity) {
+  pool->garbage += capacity;
+}
+
 // ===========================
 // struct: point_list
 // ===========================
@@ -201,7 +946,7 @@ typedef struct {
 } point_list_t;
 
 point_list_t point_list_alloc(size_t capacity) {
-  ImVec2 *items = malloc(sizeof(ImVec2) * capacity);
+  ImVec2 *items = mem_alloc(sizeof(ImVec2) * capacity);
   return (point_list_t){
       .items = items,
       .length = 0,
@@ -209,171 +954,1652 @@ point_list_t point_list_alloc(size_t capacity) {
   };
 }
 
-ImVec2 *point_list_push(point_list_t *list) {
-  if (list->length + 1 >= list->capacity) {
-    list->capacity *= 2;
-    list->items = realloc(list->items, sizeof(ImVec2) * list->capacity);
+void point_list_clear(point_list_t *list) { list->length = 0; }
+
+void point_list_free(point_list_t *list) { mem_free(list->items); }
+
+// ===========================
+// struct: point pool
+// ===========================
+
+// hands out point buffers in power of two size classes. buffers are carved out
+// of slabs, and released buffers are kept on a free list per class until they
+// are handed out again, so a buffer is only ever reused for a list of about
+// the same size. buffers above the largest class are allocated on their own.
+// lists taken from the pool must be grown with point_pool_push.
+typedef struct {
+  arena_t *slabs;
+  // heads of the free list of each class. a free buffer holds the next buffer
+  // of its list in its first bytes.
+  void *free_lists[POINT_POOL_CLASS_COUNT];
+  // bytes held by the buffers in the free lists
+  size_t free_bytes;
+} point_pool_t;
+
+void point_pool_init(point_pool_t *pool) {
+  *pool = (point_pool_t){
+      .slabs = arena_alloc(POINT_POOL_SLAB_SIZE),
+  };
+}
+
+// returns the smallest class with room for capacity points, or
+// POINT_POOL_CLASS_COUNT if capacity is above the largest class
+int point_pool_class(size_t capacity) {
+  int size_class = 0;
+  while (size_class < POINT_POOL_CLASS_COUNT &&
+         ((size_t)POINT_POOL_MIN_CAPACITY << size_class) < capacity) {
+    ++size_class;
   }
-  ImVec2 *item = list->items + list->length;
-  list->length += 1;
-  return item;
+  return size_class;
 }
 
-void point_list_clear(point_list_t *list) { list->length = 0; }
+// returns an empty point list with room for at least capacity points. a
+// capacity of 0 returns a list without a buffer, which gets one on its first
+// push.
+point_list_t point_pool_take(point_pool_t *pool, size_t capacity) {
+  if (capacity == 0) {
+    return (point_list_t){0};
+  }
 
-void point_list_copy(point_list_t *dest, point_list_t *src) {
-  memcpy(dest->items, src->items, sizeof(ImVec2) * src->capacity);
-  dest->capacity = src->capacity;
-  dest->length = src->length;
-}
+  const int size_class = point_pool_class(capacity);
+  if (size_class == POINT_POOL_CLASS_COUNT) {
+    return point_list_alloc(capacity);
+  }
 
-void point_list_free(point_list_t *list) { free(list->items); }
+  const size_t class_capacity = (size_t)POINT_POOL_MIN_CAPACITY << size_class;
+  ImVec2 *items = pool->free_lists[size_class];
+  if (items != NULL) {
+    memcpy(&pool->free_lists[size_class], items, sizeof(void *));
+    pool->free_bytes -= sizeof(ImVec2) * class_capacity;
+  } else {
+    items = arena_push(pool->slabs, sizeof(ImVec2) * class_capacity);
+  }
 
-// ===========================
-// struct: entity
-// ===========================
+  return (point_list_t){
+      .items = items,
+      .length = 0,
+      .capacity = class_capacity,
+  };
+}
 
-typedef enum {
-  entity_flag_rect = 1 << 0,
-  entity_flag_path = 1 << 1,
-  entity_flag_editable_text = 1 << 2,
-  entity_flag_selected = 1 << 3,
-  entity_flag_active = 1 << 4,
-} entity_flag_t;
+// takes the buffer of list back into pool, leaving list without a buffer
+void point_pool_release(point_pool_t *pool, point_list_t *list) {
+  if (list->items == NULL) {
+    return;
+  }
 
-typedef struct entity {
-  int id;
-  entity_flag_t flags;
+  const int size_class = point_pool_class(list->capacity);
+  if (size_class == POINT_POOL_CLASS_COUNT) {
+    point_list_free(list);
+  } else {
+    memcpy(list->items, &pool->free_lists[size_class], sizeof(void *));
+    pool->free_lists[size_class] = list->items;
+    pool->free_bytes += sizeof(ImVec2) * list->capacity;
+  }
+  *list = (point_list_t){0};
+}
 
-  point_list_t points;
-  ImVec2 dimension;
-  ImColor color;
-  char content[512];
+// moves the points of list into a buffer with room for at least capacity
+// points, which must not be less than its length
+void point_pool_move(point_pool_t *pool, point_list_t *list,
+                     size_t capacity) {
+  point_list_t moved = point_pool_take(pool, capacity);
+  memcpy(moved.items, list->items, sizeof(ImVec2) * list->length);
+  moved.length = list->length;
+  point_pool_release(pool, list);
+  *list = moved;
+}
 
-  struct entity *next;
-  struct entity *prev;
-} entity_t;
+// appends a point to a list taken from pool, moving the list to a buffer twice
+// as large when it is full, and returns the new point
+ImVec2 *point_pool_push(point_pool_t *pool, point_list_t *list) {
+  if (list->length >= list->capacity) {
+    point_pool_move(pool, list,
+                    list->capacity ? list->capacity * 2
+                                   : POINT_POOL_MIN_CAPACITY);
+  }
+  return list->items + list->length++;
+}
+
+// releases every buffer taken from pool at once. lists still using them must
+// not be used anymore.
+void point_pool_clear(point_pool_t *pool) {
+  arena_reset(pool->slabs);
+  memset(pool->free_lists, 0, sizeof(pool->free_lists));
+  pool->free_bytes = 0;
+}
 
-typedef struct selected_entity {
-  entity_t *entity;
-  struct selected_entity *next;
-} selected_entity_t;
+void point_pool_free(point_pool_t *pool) {
+  arena_free(pool->slabs);
+  *pool = (point_pool_t){0};
+}
 
 // ===========================
-// struct: window info
+// struct: point chunk list
 // ===========================
 
+// a list of points stored in a chain of fixed size chunks, which strokes are
+// recorded into. appending takes constant time, as points are never moved, so
+// their addresses are stable. chunks are kept when the list is cleared, to be
+// filled again by the next stroke.
+typedef struct point_chunk {
+  struct point_chunk *next;
+  size_t length;
+  ImVec2 items[STROKE_CHUNK_CAPACITY];
+} point_chunk_t;
+
 typedef struct {
-  ImVec2 dimension;
-  ImVec2 position_top_left;
-  ImVec2 position_bottom_right;
-} window_info_t;
+  point_chunk_t *first;
+  // chunk that points are appended to. the chunks after it are empty.
+  point_chunk_t *last;
+  size_t length;
+} point_chunk_list_t;
 
-// ===========================
-// struct: game state
-// ===========================
+point_chunk_t *point_chunk_alloc(void) {
+  point_chunk_t *chunk = mem_alloc(sizeof(point_chunk_t));
+  chunk->next = NULL;
+  chunk->length = 0;
+  return chunk;
+}
 
-typedef enum {
-  tool_select,
-  tool_draw,
+ImVec2 *point_chunk_list_push(point_chunk_list_t *list) {
+  if (list->last == NULL) {
+    list->first = point_chunk_alloc();
+    list->last = list->first;
+  } else if (list->last->length == STROKE_CHUNK_CAPACITY) {
+    if (list->last->next == NULL) {
+      list->last->next = point_chunk_alloc();
+    }
+    list->last = list->last->next;
+  }
+
+  ++list->length;
+  return list->last->items + list->last->length++;
+}
+
+// returns the chunk after chunk, or the first chunk if chunk is NULL, or NULL
+// if there are no more points. the points of list are visited with
+//
+//   for (const point_chunk_t *chunk = point_chunk_list_next(list, NULL);
+//        chunk != NULL; chunk = point_chunk_list_next(list, chunk))
+const point_chunk_t *point_chunk_list_next(const point_chunk_list_t *list,
+                                           const point_chunk_t *chunk) {
+  if (chunk == list->last) {
+    return NULL;
+  }
+  chunk = chunk == NULL ? list->first : chunk->next;
+  return chunk->length > 0 ? chunk : NULL;
+}
+
+// returns point i of a chunk list, given the items of each of its chunks
+static inline const ImVec2 *point_chunk_at(const ImVec2 *const *chunks,
+                                           size_t i) {
+  return chunks[i / STROKE_CHUNK_CAPACITY] + i % STROKE_CHUNK_CAPACITY;
+}
+
+// simplifies the polyline in list with the ramer-douglas-peucker algorithm,
+// without flattening it. keep, which has room for a flag per point, is set for
+// the points that are kept, and their number is returned. the endpoints are
+// always kept, and every dropped point lies within tolerance of the simplified
+// polyline. the working memory is pushed onto scratch, and released before
+// returning.
+size_t point_chunk_list_simplify(const point_chunk_list_t *list,
+                                 float tolerance, bool *keep,
+                                 arena_t *scratch) {
+  const size_t count = list->length;
+  if (count < 3 || tolerance <= 0) {
+    memset(keep, 1, sizeof(bool) * count);
+    return count;
+  }
+
+  const arena_mark_t scratch_mark = arena_mark(scratch);
+
+  // the points of every chunk but the last fill it, so point i is found in
+  // chunk i / STROKE_CHUNK_CAPACITY
+  const size_t chunk_count =
+      (count + STROKE_CHUNK_CAPACITY - 1) / STROKE_CHUNK_CAPACITY;
+  const ImVec2 **chunks = arena_push(scratch, sizeof(ImVec2 *) * chunk_count);
+  size_t chunk_index = 0;
+  for (const point_chunk_t *chunk = point_chunk_list_next(list, NULL);
+       chunk != NULL; chunk = point_chunk_list_next(list, chunk)) {
+    chunks[chunk_index++] = chunk->items;
+  }
+
+  memset(keep, 0, sizeof(bool) * count);
+  // ranges still to be simplified, as pairs of the indices of their ends.
+  // pending ranges never overlap, so there are fewer than count of them.
+  size_t *ranges = arena_push(scratch, sizeof(size_t) * 2 * count);
+  size_t range_count = 0;
+
+  keep[0] = true;
+  keep[count - 1] = true;
+  ranges[range_count++] = 0;
+  ranges[range_count++] = count - 1;
+
+  const float tolerance_sqr = tolerance * tolerance;
+  while (range_count > 0) {
+    const size_t last = ranges[--range_count];
+    const size_t first = ranges[--range_count];
+
+    size_t farthest = first;
+    float farthest_distance_sqr = 0;
+    for (size_t i = first + 1; i < last; ++i) {
+      ImVec2 projection;
+      const ImVec2 *point = point_chunk_at(chunks, i);
+      project_point_to_segment(&projection, point_chunk_at(chunks, first),
+                               point_chunk_at(chunks, last), point);
+      const float distance_sqr = vec2_distance_sqr(&projection, point);
+      if (distance_sqr > farthest_distance_sqr) {
+        farthest = i;
+        farthest_distance_sqr = distance_sqr;
+      }
+    }
+
+    if (farthest_distance_sqr <= tolerance_sqr) {
+      continue;
+    }
+
+    keep[farthest] = true;
+    if (farthest - first > 1) {
+      ranges[range_count++] = first;
+      ranges[range_count++] = farthest;
+    }
+    if (last - farthest > 1) {
+      ranges[range_count++] = farthest;
+      ranges[range_count++] = last;
+    }
+  }
+
+  size_t kept = 0;
+  for (size_t i = 0; i < count; ++i) {
+    kept += keep[i];
+  }
+
+  arena_rewind(scratch, scratch_mark);
+  return kept;
+}
+
+// copies the points of list that keep is set for into items, which has room
+// for all of them
+void point_chunk_list_copy_kept(const point_chunk_list_t *list,
+                                const bool *keep, ImVec2 *items) {
+  for (const point_chunk_t *chunk = point_chunk_list_next(list, NULL);
+       chunk != NULL; chunk = point_chunk_list_next(list, chunk)) {
+    for (size_t i = 0; i < chunk->length; ++i) {
+      if (keep[i]) {
+        *items++ = chunk->items[i];
+      }
+    }
+    keep += chunk->length;
+  }
+}
+
+void point_chunk_list_clear(point_chunk_list_t *list) {
+  for (point_chunk_t *chunk = list->first; chunk != NULL;
+       chunk = chunk->next) {
+    chunk->length = 0;
+  }
+  list->last = list->first;
+  list->length = 0;
+}
+
+void point_chunk_list_free(point_chunk_list_t *list) {
+  while (list->first != NULL) {
+    point_chunk_t *next = list->first->next;
+    mem_free(list->first);
+    list->first = next;
+  }
+  *list = (point_chunk_list_t){0};
+}
+
+// ===========================
+// struct: segment tree
+// ===========================
+
+// bounds over the segments of a long path, so that hit tests only scan the
+// segments near the point. the leaves bound runs of SEGMENT_RUN_LENGTH
+// consecutive segments, and each level above bounds pairs of nodes of the one
+// below, up to a single root. node i of a level has the nodes 2i and 2i + 1 of
+// the level below as children.
+typedef struct {
+  // the nodes of every level, from the leaves up to the root
+  aabb_t *bounds;
+  uint32_t bounds_count;
+  // number of leaves, which is 0 for paths too short to have a tree
+  uint32_t run_count;
+} segment_tree_t;
+
+// a node of a segment tree, as its level, with the leaves at 0, and its index
+// in that level
+typedef struct {
+  int level;
+  uint32_t index;
+} segment_tree_node_t;
+
+// builds the tree over the segments between the point_count points, reusing
+// its memory if it was built before
+void segment_tree_build(segment_tree_t *tree, const ImVec2 *points,
+                        size_t point_count) {
+  const size_t segment_count = point_count > 0 ? point_count - 1 : 0;
+  const size_t run_count =
+      (segment_count + SEGMENT_RUN_LENGTH - 1) / SEGMENT_RUN_LENGTH;
+  // a single run is scanned as fast as a tree over it
+  if (run_count < 2) {
+    tree->run_count = 0;
+    return;
+  }
+
+  size_t bounds_count = 0;
+  for (size_t length = run_count; length > 1; length = (length + 1) / 2) {
+    bounds_count += length;
+  }
+  ++bounds_count;
+
+  if (bounds_count > tree->bounds_count) {
+    tree->bounds = mem_realloc(tree->bounds, sizeof(aabb_t) * bounds_count);
+  }
+  tree->bounds_count = (uint32_t)bounds_count;
+  tree->run_count = (uint32_t)run_count;
+
+  for (size_t i = 0; i < run_count; ++i) {
+    const size_t first = i * SEGMENT_RUN_LENGTH;
+    const size_t end = first + SEGMENT_RUN_LENGTH < segment_count
+                           ? first + SEGMENT_RUN_LENGTH
+                           : segment_count;
+    tree->bounds[i] = aabb_from_points(points + first, end - first + 1);
+  }
+
+  aabb_t *level = tree->bounds;
+  for (size_t length = run_count; length > 1; length = (length + 1) / 2) {
+    aabb_t *parents = level + length;
+    for (size_t i = 0; i < length; i += 2) {
+      parents[i / 2] = level[i];
+      if (i + 1 < length) {
+        aabb_union(parents + i / 2, level + i + 1);
+      }
+    }
+    level = parents;
+  }
+}
+
+// translates the tree along with the path it was built over
+void segment_tree_move(segment_tree_t *tree, const ImVec2 *delta) {
+  if (tree->run_count > 0) {
+    // an aabb is its min and max corners, one after the other
+    points_translate(&tree->bounds[0].min, tree->bounds_count * 2, delta);
+  }
+}
+
+// returns whether any of the segments between the point_count points that
+// the tree was built over is within a squared distance of distance_sqr of
+// point. only the runs whose bounds are that close are scanned.
+bool segment_tree_is_near(const segment_tree_t *tree, const ImVec2 *points,
+                          size_t point_count, const ImVec2 *point,
+                          float distance_sqr) {
+  const size_t segment_count = point_count - 1;
+
+  uint32_t level_first[SEGMENT_TREE_MAX_LEVELS];
+  uint32_t level_length[SEGMENT_TREE_MAX_LEVELS];
+  int level_count = 0;
+  uint32_t first = 0;
+  for (uint32_t length = tree->run_count;; length = (length + 1) / 2) {
+    level_first[level_count] = first;
+    level_length[level_count++] = length;
+    if (length == 1) {
+      break;
+    }
+    first += length;
+  }
+
+  segment_tree_node_t stack[SEGMENT_TREE_MAX_LEVELS * 2];
+  size_t stack_size = 0;
+  stack[stack_size++] = (segment_tree_node_t){level_count - 1, 0};
+
+  while (stack_size > 0) {
+    const segment_tree_node_t node = stack[--stack_size];
+    const int level = node.level;
+    const uint32_t index = node.index;
+
+    const aabb_t *bounds = &tree->bounds[level_first[level] + index];
+    if (aabb_distance_sqr(bounds, point) > distance_sqr) {
+      continue;
+    }
+
+    if (level == 0) {
+      const size_t first_segment = (size_t)index * SEGMENT_RUN_LENGTH;
+      const size_t count = segment_count - first_segment < SEGMENT_RUN_LENGTH
+                               ? segment_count - first_segment
+                               : SEGMENT_RUN_LENGTH;
+      if (segments_distance_sqr(points + first_segment, count, point,
+                                distance_sqr) <= distance_sqr) {
+        return true;
+      }
+      continue;
+    }
+
+    const uint32_t child = index * 2;
+    if (child + 1 < level_length[level - 1]) {
+      stack[stack_size++] = (segment_tree_node_t){level - 1, child + 1};
+    }
+    stack[stack_size++] = (segment_tree_node_t){level - 1, child};
+  }
+
+  return false;
+}
+
+void segment_tree_free(segment_tree_t *tree) {
+  mem_free(tree->bounds);
+  *tree = (segment_tree_t){0};
+}
+
+// ===========================
+// struct: entity
+// ===========================
+
+typedef enum {
+  entity_flag_rect = 1 << 0,
+  entity_flag_path = 1 << 1,
+  entity_flag_editable_text = 1 << 2,
+  entity_flag_selected = 1 << 3,
+  entity_flag_active = 1 << 4,
+} entity_flag_t;
+
+// refers to an entity in the entity store. a handle keeps referring to the
+// same entity as it moves around the store, and stops resolving once the
+// entity is removed. the zero handle never resolves.
+typedef struct {
+  uint32_t slot;
+  uint32_t generation;
+} entity_handle_t;
+
+bool entity_handle_equals(const entity_handle_t *a, const entity_handle_t *b) {
+  return a->slot == b->slot && a->generation == b->generation;
+}
+
+// the fields of an entity that passes over the document touch. everything else
+// is in entity_cold_t, so that these stay small.
+typedef struct entity {
+  entity_handle_t handle;
+  entity_flag_t flags;
+  ImU32 color;
+  // stacking order. entities with a higher z are drawn on top.
+  uint32_t z;
+  // query_id of the last grid query that visited this entity, so that
+  // entities stored in several cells are only tested once per query
+  uint32_t grid_query_id;
+
+  point_list_t points;
+  // cached bounds of points. entities in the document are indexed in the
+  // spatial grid and the bvh under these bounds, so they must be kept in sync
+  // with points. once pushed, an entity only changes points when it is moved,
+  // and move_entity translates the bounds along with them.
+  aabb_t bounds;
+
+  // range of the instances of this entity in the committed instances of the
+  // canvas renderer
+  uint32_t instance_first;
+  uint32_t instance_count;
+  // index of the handle of this entity in the selection, if it is selected
+  uint32_t selection_index;
+
+  // whether bounds no longer reflects points and has to be recomputed
+  bool is_bounds_dirty;
+  // whether the instances no longer match the entity and have to be
+  // regenerated before the next upload
+  bool is_geometry_dirty;
+} entity_t;
+
+// the fields of an entity that are rarely used
+typedef struct {
+  int id;
+  // size of the text box of text entities
+  ImVec2 dimension;
+  // span of the nul terminated text of text entities in the text pool
+  uint32_t text_offset;
+  uint32_t text_capacity;
+  // bounds over the segments of paths, which hit tests go through
+  segment_tree_t segments;
+} entity_cold_t;
+
+// ===========================
+// struct: entity list
+// ===========================
+
+typedef struct {
+  entity_t **items;
+  size_t length;
+  size_t capacity;
+} entity_list_t;
+
+// makes room for at least capacity entities in a single allocation
+void entity_list_reserve(entity_list_t *list, size_t capacity) {
+  if (capacity > list->capacity) {
+    list->capacity = capacity;
+    list->items = mem_realloc(list->items, sizeof(entity_t *) * capacity);
+  }
+}
+
+void entity_list_push(entity_list_t *list, entity_t *entity) {
+  if (list->length >= list->capacity) {
+    list->capacity = list->capacity ? list->capacity * 2 : 8;
+    list->items = mem_realloc(list->items, sizeof(entity_t *) * list->capacity);
+  }
+  list->items[list->length++] = entity;
+}
+
+// removes one occurrence of entity from the list. order is not preserved.
+void entity_list_remove(entity_list_t *list, const entity_t *entity) {
+  for (size_t i = 0; i < list->length; ++i) {
+    if (list->items[i] == entity) {
+      list->items[i] = list->items[--list->length];
+      return;
+    }
+  }
+}
+
+void entity_list_clear(entity_list_t *list) { list->length = 0; }
+
+void entity_list_free(entity_list_t *list) {
+  mem_free(list->items);
+  *list = (entity_list_t){0};
+}
+
+// ===========================
+// struct: entity handle list
+// ===========================
+
+typedef struct {
+  entity_handle_t *items;
+  size_t length;
+  size_t capacity;
+} entity_handle_list_t;
+
+// makes room for at least capacity handles in a single allocation
+void entity_handle_list_reserve(entity_handle_list_t *list, size_t capacity) {
+  if (capacity > list->capacity) {
+    list->capacity = capacity;
+    list->items = mem_realloc(list->items, sizeof(entity_handle_t) * capacity);
+  }
+}
+
+void entity_handle_list_push(entity_handle_list_t *list,
+                             const entity_handle_t *handle) {
+  if (list->length >= list->capacity) {
+    list->capacity = list->capacity ? list->capacity * 2 : 8;
+    list->items =
+        mem_realloc(list->items, sizeof(entity_handle_t) * list->capacity);
+  }
+  list->items[list->length++] = *handle;
+}
+
+// removes one occurrence of handle from the list. order is not preserved.
+void entity_handle_list_remove(entity_handle_list_t *list,
+                               const entity_handle_t *handle) {
+  for (size_t i = 0; i < list->length; ++i) {
+    if (entity_handle_equals(list->items + i, handle)) {
+      list->items[i] = list->items[--list->length];
+      return;
+    }
+  }
+}
+
+void entity_handle_list_clear(entity_handle_list_t *list) { list->length = 0; }
+
+void entity_handle_list_free(entity_handle_list_t *list) {
+  mem_free(list->items);
+  *list = (entity_handle_list_t){0};
+}
+
+// ===========================
+// struct: entity store
+// ===========================
+
+// entities are stored densely in an array, so that passes over the document
+// are linear scans. removing an entity moves the last entity into its place,
+// which is why anything that outlives a change to the store refers to
+// entities by handle: handles resolve through a slot that tracks where the
+// entity currently is. entity pointers are only valid until the store
+// changes.
+
+typedef struct {
+  // index of the entity in entity_store_t::items while the slot is in use,
+  // and of the next free slot otherwise
+  uint32_t index;
+  // incremented whenever the slot is freed, so that handles to the entity
+  // that used it no longer resolve
+  uint32_t generation;
+} entity_slot_t;
+
+#define ENTITY_SLOT_NONE UINT32_MAX
+
+typedef struct {
+  // entities in no particular order
+  entity_t *items;
+  // cold fields of the entity at the same index in items
+  entity_cold_t *cold;
+  size_t length;
+  size_t capacity;
+
+  entity_slot_t *slots;
+  size_t slot_count;
+  size_t slot_capacity;
+  uint32_t free_slot;
+
+  // handles of the entities from bottom to top. removing entities leaves
+  // handles that no longer resolve, until entity_store_prune_z_order.
+  entity_handle_list_t z_order;
+} entity_store_t;
+
+void entity_store_init(entity_store_t *store) {
+  *store = (entity_store_t){.free_slot = ENTITY_SLOT_NONE};
+}
+
+// appends a zeroed entity and its cold fields to the store. its handle is set,
+// but it is not in z_order yet.
+entity_t *entity_store_add(entity_store_t *store) {
+  uint32_t slot = store->free_slot;
+  if (slot != ENTITY_SLOT_NONE) {
+    store->free_slot = store->slots[slot].index;
+  } else {
+    if (store->slot_count >= store->slot_capacity) {
+      store->slot_capacity =
+          store->slot_capacity ? store->slot_capacity * 2 : 256;
+      store->slots = mem_realloc(store->slots,
+                             sizeof(entity_slot_t) * store->slot_capacity);
+    }
+    slot = (uint32_t)store->slot_count++;
+    // generation 0 is reserved for the zero handle
+    store->slots[slot].generation = 1;
+  }
+
+  if (store->length >= store->capacity) {
+    store->capacity = store->capacity ? store->capacity * 2 : 256;
+    store->items =
+        mem_realloc(store->items, sizeof(entity_t) * store->capacity);
+    store->cold =
+        mem_realloc(store->cold, sizeof(entity_cold_t) * store->capacity);
+  }
+
+  store->slots[slot].index = (uint32_t)store->length;
+  store->cold[store->length] = (entity_cold_t){0};
+  entity_t *entity = store->items + store->length++;
+  *entity = (entity_t){
+      .handle = {slot, store->slots[slot].generation},
+  };
+  return entity;
+}
+
+entity_cold_t *entity_store_cold(const entity_store_t *store,
+                                 const entity_t *entity) {
+  return store->cold + (entity - store->items);
+}
+
+// returns the entity handle refers to, or NULL if it has been removed
+entity_t *entity_store_get(const entity_store_t *store,
+                           const entity_handle_t *handle) {
+  if (handle->slot >= store->slot_count) {
+    return NULL;
+  }
+  const entity_slot_t *slot = store->slots + handle->slot;
+  if (slot->generation != handle->generation) {
+    return NULL;
+  }
+  return store->items + slot->index;
+}
+
+// removes entity from the store, moving the last entity into its place
+void entity_store_remove(entity_store_t *store, entity_t *entity) {
+  const uint32_t index = (uint32_t)(entity - store->items);
+
+  entity_slot_t *slot = store->slots + entity->handle.slot;
+  ++slot->generation;
+  slot->index = store->free_slot;
+  store->free_slot = entity->handle.slot;
+
+  const size_t last = store->length - 1;
+  if (index != last) {
+    *entity = store->items[last];
+    store->cold[index] = store->cold[last];
+    store->slots[entity->handle.slot].index = index;
+  }
+  --store->length;
+}
+
+// drops the handles of removed entities from z_order
+void entity_store_prune_z_order(entity_store_t *store) {
+  entity_handle_list_t *z_order = &store->z_order;
+  size_t kept = 0;
+  for (size_t i = 0; i < z_order->length; ++i) {
+    if (entity_store_get(store, z_order->items + i) != NULL) {
+      z_order->items[kept++] = z_order->items[i];
+    }
+  }
+  z_order->length = kept;
+}
+
+void entity_store_free(entity_store_t *store) {
+  mem_free(store->items);
+  mem_free(store->cold);
+  mem_free(store->slots);
+  entity_handle_list_free(&store->z_order);
+  entity_store_init(store);
+}
+
+// ===========================
+// struct: spatial grid
+// ===========================
+
+// an unbounded uniform grid over entity bounds. cells are hashed into a fixed
+// number of buckets, so an entity can share a bucket with entities from a
+// different cell; queries always confirm candidates against their bounds.
+
+typedef struct {
+  entity_handle_list_t buckets[GRID_BUCKET_COUNT];
+  entity_handle_list_t oversized;
+  uint32_t query_id;
+} spatial_grid_t;
+
+typedef struct {
+  int min_x;
+  int min_y;
+  int max_x;
+  int max_y;
+} grid_cell_range_t;
+
+// returns the cells covered by aabb. bounds that are not finite, such as the
+// empty bounds of an entity without points, or that reach past
+// GRID_MAX_CELL_INDEX have no cell index. they get a range of more than
+// GRID_MAX_CELLS_PER_ENTITY cells, so that entities are kept in the oversized
+// list instead.
+grid_cell_range_t grid_cell_range(const aabb_t *aabb) {
+  const float limit = (float)GRID_CELL_SIZE * GRID_MAX_CELL_INDEX;
+  if (!(fabsf(aabb->min.x) < limit && fabsf(aabb->min.y) < limit &&
+        fabsf(aabb->max.x) < limit && fabsf(aabb->max.y) < limit)) {
+    return (grid_cell_range_t){.max_x = GRID_MAX_CELLS_PER_ENTITY};
+  }
+
+  return (grid_cell_range_t){
+      .min_x = (int)floorf(aabb->min.x / GRID_CELL_SIZE),
+      .min_y = (int)floorf(aabb->min.y / GRID_CELL_SIZE),
+      .max_x = (int)floorf(aabb->max.x / GRID_CELL_SIZE),
+      .max_y = (int)floorf(aabb->max.y / GRID_CELL_SIZE),
+  };
+}
+
+size_t grid_cell_range_count(const grid_cell_range_t *range) {
+  return (size_t)(range->max_x - range->min_x + 1) *
+         (size_t)(range->max_y - range->min_y + 1);
+}
+
+entity_handle_list_t *grid_bucket(spatial_grid_t *grid, int cell_x,
+                                  int cell_y) {
+  const uint32_t hash =
+      (uint32_t)cell_x * 73856093u ^ (uint32_t)cell_y * 19349663u;
+  return &grid->buckets[hash & (GRID_BUCKET_COUNT - 1)];
+}
+
+// inserts entity into every cell covered by entity->bounds
+void spatial_grid_insert(spatial_grid_t *grid, entity_t *entity) {
+  const grid_cell_range_t range = grid_cell_range(&entity->bounds);
+  if (grid_cell_range_count(&range) > GRID_MAX_CELLS_PER_ENTITY) {
+    entity_handle_list_push(&grid->oversized, &entity->handle);
+    return;
+  }
+  for (int y = range.min_y; y <= range.max_y; ++y) {
+    for (int x = range.min_x; x <= range.max_x; ++x) {
+      entity_handle_list_push(grid_bucket(grid, x, y), &entity->handle);
+    }
+  }
+}
+
+// removes entity from the grid. entity->bounds must be the bounds it was
+// inserted with.
+void spatial_grid_remove(spatial_grid_t *grid, const entity_t *entity) {
+  const grid_cell_range_t range = grid_cell_range(&entity->bounds);
+  if (grid_cell_range_count(&range) > GRID_MAX_CELLS_PER_ENTITY) {
+    entity_handle_list_remove(&grid->oversized, &entity->handle);
+    return;
+  }
+  for (int y = range.min_y; y <= range.max_y; ++y) {
+    for (int x = range.min_x; x <= range.max_x; ++x) {
+      entity_handle_list_remove(grid_bucket(grid, x, y), &entity->handle);
+    }
+  }
+}
+
+void spatial_grid_clear(spatial_grid_t *grid) {
+  for (size_t i = 0; i < GRID_BUCKET_COUNT; ++i) {
+    entity_handle_list_clear(&grid->buckets[i]);
+  }
+  entity_handle_list_clear(&grid->oversized);
+}
+
+// collects every entity whose bounds, grown by margin, contain point into out.
+// out is cleared first.
+void spatial_grid_query_point(spatial_grid_t *grid,
+                              const entity_store_t *store,
+                              const ImVec2 *point, float margin,
+                              entity_list_t *out) {
+  entity_list_clear(out);
+
+  const uint32_t query_id = ++grid->query_id;
+  const aabb_t query_area = {{point->x - margin, point->y - margin},
+                             {point->x + margin, point->y + margin}};
+  const grid_cell_range_t range = grid_cell_range(&query_area);
+
+  for (int y = range.min_y; y <= range.max_y; ++y) {
+    for (int x = range.min_x; x <= range.max_x; ++x) {
+      const entity_handle_list_t *bucket = grid_bucket(grid, x, y);
+      for (size_t i = 0; i < bucket->length; ++i) {
+        entity_t *entity = entity_store_get(store, bucket->items + i);
+        if (entity->grid_query_id == query_id) {
+          continue;
+        }
+        entity->grid_query_id = query_id;
+        if (aabb_contains_point(&entity->bounds, point, margin)) {
+          entity_list_push(out, entity);
+        }
+      }
+    }
+  }
+
+  for (size_t i = 0; i < grid->oversized.length; ++i) {
+    entity_t *entity = entity_store_get(store, grid->oversized.items + i);
+    if (aabb_contains_point(&entity->bounds, point, margin)) {
+      entity_list_push(out, entity);
+    }
+  }
+}
+
+// ===========================
+// struct: bvh
+// ===========================
+
+// a bounding volume hierarchy over entity bounds, used to find the entities
+// touched by the selection rectangle. it is rebuilt from scratch on demand
+// after the document changes, which only happens once per rubber band drag
+// since the document does not change while area selecting. the bvh holds
+// entity pointers, which is fine since any change to the entity store also
+// marks the bvh dirty.
+
+typedef struct {
+  aabb_t bounds;
+  // every entity under this node is in bvh_t::entities[first, first + count)
+  uint32_t first;
+  uint32_t count;
+  // index of the left child. the right child is at left + 1. leaves have no
+  // children and have left set to 0, which is always the root.
+  uint32_t left;
+} bvh_node_t;
+
+typedef struct {
+  bvh_node_t *nodes;
+  size_t node_count;
+  size_t node_capacity;
+  entity_list_t entities;
+  bool is_dirty;
+} bvh_t;
+
+float bvh_centroid(const entity_t *entity, int axis) {
+  return axis == 0 ? entity->bounds.min.x + entity->bounds.max.x
+                   : entity->bounds.min.y + entity->bounds.max.y;
+}
+
+// partially sorts items so that the item at nth is the one that would be there
+// if items were sorted by centroid along axis
+void bvh_select_nth(entity_t **items, size_t count, size_t nth, int axis) {
+  size_t lo = 0;
+  size_t hi = count - 1;
+  while (lo < hi) {
+    const float pivot = bvh_centroid(items[lo + (hi - lo) / 2], axis);
+    size_t i = lo;
+    size_t j = hi;
+    while (i <= j) {
+      while (bvh_centroid(items[i], axis) < pivot) {
+        ++i;
+      }
+      while (bvh_centroid(items[j], axis) > pivot) {
+        --j;
+      }
+      if (i <= j) {
+        entity_t *tmp = items[i];
+        items[i] = items[j];
+        items[j] = tmp;
+        ++i;
+        if (j == 0) {
+          break;
+        }
+        --j;
+      }
+    }
+    if (nth <= j) {
+      hi = j;
+    } else if (nth >= i) {
+      lo = i;
+    } else {
+      return;
+    }
+  }
+}
+
+void bvh_build_node(bvh_t *bvh, uint32_t node_index, uint32_t first,
+                    uint32_t count) {
+  entity_t **items = bvh->entities.items + first;
+
+  aabb_t bounds = items[0]->bounds;
+  for (uint32_t i = 1; i < count; ++i) {
+    aabb_union(&bounds, &items[i]->bounds);
+  }
+
+  bvh->nodes[node_index] = (bvh_node_t){
+      .bounds = bounds,
+      .first = first,
+      .count = count,
+      .left = 0,
+  };
+
+  if (count <= BVH_LEAF_SIZE) {
+    return;
+  }
+
+  const int axis =
+      bounds.max.x - bounds.min.x >= bounds.max.y - bounds.min.y ? 0 : 1;
+  const uint32_t left_count = count / 2;
+  bvh_select_nth(items, count, left_count, axis);
+
+  const uint32_t left = (uint32_t)bvh->node_count;
+  bvh->node_count += 2;
+  bvh->nodes[node_index].left = left;
+
+  bvh_build_node(bvh, left, first, left_count);
+  bvh_build_node(bvh, left + 1, first + left_count, count - left_count);
+}
+
+void bvh_build(bvh_t *bvh, entity_store_t *store) {
+  entity_list_clear(&bvh->entities);
+  entity_list_reserve(&bvh->entities, store->capacity);
+  for (size_t i = 0; i < store->length; ++i) {
+    entity_list_push(&bvh->entities, store->items + i);
+  }
+
+  bvh->node_count = 0;
+  bvh->is_dirty = false;
+
+  const size_t entity_count = bvh->entities.length;
+  if (entity_count == 0) {
+    return;
+  }
+
+  // a binary tree whose leaves hold at least one entity has fewer than
+  // 2 * entity_count nodes
+  // sized for the capacity of the store so that the nodes only grow when the
+  // store itself does
+  if (bvh->node_capacity < store->capacity * 2) {
+    bvh->node_capacity = store->capacity * 2;
+    bvh->nodes =
+        mem_realloc(bvh->nodes, sizeof(bvh_node_t) * bvh->node_capacity);
+  }
+
+  bvh->node_count = 1;
+  bvh_build_node(bvh, 0, 0, (uint32_t)entity_count);
+}
+
+// ===========================
+// struct: window info
+// ===========================
+
+typedef struct {
+  ImVec2 dimension;
+  ImVec2 position_top_left;
+  ImVec2 position_bottom_right;
+} window_info_t;
+
+// ===========================
+// struct: canvas instances
+// ===========================
+
+// a shape drawn by the canvas renderer as one instanced quad. instances with a
+// positive radius are capsules around the segment a-b, which draws path
+// segments with round caps as well as dots when a == b. instances with a
+// radius of 0 are rects filled between the corners a and b.
+typedef struct {
+  ImVec2 a;
+  ImVec2 b;
+  float radius;
+  ImU32 color;
+  // 1 for the instances of dragged entities, which are displaced by the drag
+  // offset of the renderer, and 0 for any other
+  float dragged;
+} canvas_instance_t;
+
+typedef struct {
+  canvas_instance_t *items;
+  size_t length;
+  size_t capacity;
+  // lists with an arena grow onto it instead of the heap, leaving their
+  // previous items behind, and are never freed
+  arena_t *arena;
+} canvas_instance_list_t;
+
+// appends count instances to list and returns the first of them
+canvas_instance_t *canvas_instance_list_push_n(canvas_instance_list_t *list,
+                                               size_t count) {
+  if (list->length + count > list->capacity) {
+    if (list->capacity == 0) {
+      list->capacity = 256;
+    }
+    while (list->length + count > list->capacity) {
+      list->capacity *= 2;
+    }
+
+    if (list->arena != NULL) {
+      canvas_instance_t *items =
+          arena_push(list->arena, sizeof(canvas_instance_t) * list->capacity);
+      if (list->length > 0) {
+        memcpy(items, list->items, sizeof(canvas_instance_t) * list->length);
+      }
+      list->items = items;
+    } else {
+      list->items =
+          mem_realloc(list->items, sizeof(canvas_instance_t) * list->capacity);
+    }
+  }
+  canvas_instance_t *first = list->items + list->length;
+  list->length += count;
+  return first;
+}
+
+canvas_instance_t *canvas_instance_list_push(canvas_instance_list_t *list) {
+  return canvas_instance_list_push_n(list, 1);
+}
+
+void canvas_instance_list_clear(canvas_instance_list_t *list) {
+  list->length = 0;
+}
+
+void canvas_instance_list_free(canvas_instance_list_t *list) {
+  if (list->arena == NULL) {
+    mem_free(list->items);
+  }
+  *list = (canvas_instance_list_t){0};
+}
+
+void canvas_instance_list_push_segment(canvas_instance_list_t *list,
+                                       const ImVec2 *a, const ImVec2 *b,
+                                       float radius, ImU32 color) {
+  *canvas_instance_list_push(list) = (canvas_instance_t){
+      .a = *a,
+      .b = *b,
+      .radius = radius,
+      .color = color,
+  };
+}
+
+void canvas_instance_list_push_rect(canvas_instance_list_t *list,
+                                    const ImVec2 *a, const ImVec2 *b,
+                                    ImU32 color) {
+  *canvas_instance_list_push(list) = (canvas_instance_t){
+      .a = *a,
+      .b = *b,
+      .radius = 0,
+      .color = color,
+  };
+}
+
+// pushes the outline of the rect spanned by the corners a and b
+void canvas_instance_list_push_rect_outline(canvas_instance_list_t *list,
+                                            const ImVec2 *a, const ImVec2 *b,
+                                            float thickness, ImU32 color) {
+  const ImVec2 corners[4] = {*a, {b->x, a->y}, *b, {a->x, b->y}};
+  for (int i = 0; i < 4; ++i) {
+    canvas_instance_list_push_segment(list, &corners[i], &corners[(i + 1) % 4],
+                                      thickness / 2, color);
+  }
+}
+
+void canvas_instance_list_push_path(canvas_instance_list_t *list,
+                                    const ImVec2 *points, size_t count,
+                                    ImU32 color) {
+  if (count == 1) {
+    canvas_instance_list_push_segment(list, points, points,
+                                      PATH_THICKNESS / 2.0f, color);
+  }
+  for (size_t i = 1; i < count; ++i) {
+    canvas_instance_list_push_segment(list, points + i - 1, points + i,
+                                      PATH_THICKNESS / 2.0f, color);
+  }
+}
+
+// like canvas_instance_list_push_path, but for a path whose points are in a
+// chunk list. the segments between chunks are pushed as well.
+void canvas_instance_list_push_chunked_path(canvas_instance_list_t *list,
+                                            const point_chunk_list_t *points,
+                                            ImU32 color) {
+  if (points->length == 1) {
+    canvas_instance_list_push_segment(list, points->first->items,
+                                      points->first->items,
+                                      PATH_THICKNESS / 2.0f, color);
+  }
+
+  const ImVec2 *prev = NULL;
+  for (const point_chunk_t *chunk = point_chunk_list_next(points, NULL);
+       chunk != NULL; chunk = point_chunk_list_next(points, chunk)) {
+    for (size_t i = 0; i < chunk->length; ++i) {
+      if (prev != NULL) {
+        canvas_instance_list_push_segment(list, prev, chunk->items + i,
+                                          PATH_THICKNESS / 2.0f, color);
+      }
+      prev = chunk->items + i;
+    }
+  }
+}
+
+// pushes the instances that draw entity: its shape, except for text which is
+// drawn by imgui, followed by its selection handles or outline. the latter are
+// pushed hidden when the entity is not selected, so that selecting an entity
+// does not change its number of instances.
+void canvas_instance_list_push_entity(canvas_instance_list_t *list,
+                                      const entity_t *entity) {
+  const size_t first = list->length;
+  const ImU32 color = entity->color;
+  if (entity->flags & entity_flag_path) {
+    canvas_instance_list_push_path(list, entity->points.items,
+                                   entity->points.length, color);
+  } else if (entity->flags & entity_flag_rect) {
+    canvas_instance_list_push_rect(list, entity->points.items,
+                                   entity->points.items + 2, color);
+  }
+
+  const size_t selection_first = list->length;
+  const size_t no_of_points = entity->points.length;
+  if (entity->flags & entity_flag_path && no_of_points > 1) {
+    canvas_instance_list_push_segment(list, entity->points.items,
+                                      entity->points.items,
+                                      SELECTION_HANDLE_RADIUS, 0xFFFFFFFF);
+    canvas_instance_list_push_segment(
+        list, entity->points.items + no_of_points - 1,
+        entity->points.items + no_of_points - 1, SELECTION_HANDLE_RADIUS,
+        0xFFFFFFFF);
+  } else if (entity->flags & (entity_flag_rect | entity_flag_editable_text)) {
+    canvas_instance_list_push_rect_outline(
+        list, entity->points.items, entity->points.items + 2, 2.0,
+        igGetColorU32_Vec4((ImVec4){0.537, 0.706, 1, 1}));
+  }
+
+  if ((entity->flags & entity_flag_selected) == 0) {
+    // an empty rect, which covers no pixels
+    for (size_t i = selection_first; i < list->length; ++i) {
+      list->items[i] = (canvas_instance_t){0};
+    }
+  } else if (entity->flags & (entity_flag_path | entity_flag_rect)) {
+    // selected paths and rects follow the selection while it is dragged
+    for (size_t i = first; i < list->length; ++i) {
+      list->items[i].dragged = 1;
+    }
+  }
+}
+
+// ===========================
+// struct: canvas renderer
+// ===========================
+
+// draws the canvas with sokol_gfx. committed retains the instances of every
+// entity in the document, bottom to top, and is mirrored in a persistent
+// vertex buffer that is only uploaded again when it changes. new entities are
+// appended to it. entities that change are regenerated in place, unless their
+// number of instances changes, in which case committed is compacted. removed
+// entities leave hidden instances behind until then. overlay holds what is
+// drawn on top of the document for a single frame, such as the shape being
+// drawn. it lives on the frame arena and is streamed every frame. only the
+// instances of the entities marked visible during the frame are drawn.
+typedef struct {
+  sg_pipeline pipeline;
+  sg_buffer corner_buffer;
+
+  canvas_instance_list_t committed;
+  sg_buffer committed_buffer;
+  size_t committed_buffer_capacity;
+  // entities whose instances must be regenerated before the next upload
+  entity_handle_list_t dirty_entities;
+  // number of hidden instances left behind in committed by removed entities
+  size_t hole_count;
+  // scratch list that instances are regenerated and compacted into
+  canvas_instance_list_t scratch;
+  // committed must be compacted before the next upload
+  bool is_committed_stale;
+  // committed has changed since it was last uploaded
+  bool is_committed_dirty;
+
+  canvas_instance_list_t overlay;
+  sg_buffer overlay_buffer;
+  size_t overlay_buffer_capacity;
+  int overlay_buffer_offset;
+
+  // offset that the instances of dragged entities are drawn displaced by
+  ImVec2 drag_offset;
+  // entities on screen this frame, sorted by their instances before drawing
+  entity_list_t visible_entities;
+
+  size_t uploaded_bytes;
+  size_t drawn_instance_count;
+  int draw_call_count;
+} canvas_renderer_t;
+
+// appends the instances of an entity that was just added to the top of the
+// document
+void canvas_renderer_push_entity(canvas_renderer_t *renderer,
+                                 entity_t *entity) {
+  entity->is_geometry_dirty = false;
+  entity->instance_first = renderer->committed.length;
+  canvas_instance_list_push_entity(&renderer->committed, entity);
+  entity->instance_count = renderer->committed.length - entity->instance_first;
+  renderer->is_committed_dirty = true;
+}
+
+// must be called when the points, color or selection state of an entity in
+// the document change. the selection functions call it themselves.
+void canvas_renderer_invalidate(canvas_renderer_t *renderer,
+                                entity_t *entity) {
+  if (!entity->is_geometry_dirty) {
+    entity->is_geometry_dirty = true;
+    entity_handle_list_push(&renderer->dirty_entities, &entity->handle);
+  }
+}
+
+// hides the instances of an entity that is removed from the document
+void canvas_renderer_remove_entity(canvas_renderer_t *renderer,
+                                   entity_t *entity) {
+  if (entity->is_geometry_dirty) {
+    entity->is_geometry_dirty = false;
+    entity_handle_list_remove(&renderer->dirty_entities, &entity->handle);
+  }
+
+  canvas_instance_t *first = renderer->committed.items + entity->instance_first;
+  memset(first, 0, sizeof(canvas_instance_t) * entity->instance_count);
+  renderer->hole_count += entity->instance_count;
+  entity->instance_count = 0;
+  renderer->is_committed_dirty = true;
+}
+
+// forgets the entities marked visible on the last frame. store is the
+// document, which may end up visible as a whole.
+void canvas_renderer_begin_culling(canvas_renderer_t *renderer,
+                                   const entity_store_t *store) {
+  entity_list_clear(&renderer->visible_entities);
+  entity_list_reserve(&renderer->visible_entities, store->capacity);
+}
+
+// draws the instances of entity this frame
+void canvas_renderer_mark_visible(canvas_renderer_t *renderer,
+                                  entity_t *entity) {
+  entity_list_push(&renderer->visible_entities, entity);
+}
+
+// drops every instance, once the document is empty
+void canvas_renderer_clear(canvas_renderer_t *renderer) {
+  canvas_instance_list_clear(&renderer->committed);
+  entity_handle_list_clear(&renderer->dirty_entities);
+  renderer->hole_count = 0;
+  renderer->is_committed_stale = false;
+  renderer->is_committed_dirty = true;
+}
+
+// ===========================
+// struct: selection
+// ===========================
+
+// the selected entities, as a dense list of their handles. entity_flag_selected
+// is set on exactly the entities in the selection, and each of them knows
+// where its handle is through selection_index, so that entities are added and
+// removed in constant time. the functions below invalidate the instances of
+// the entities whose selection state they change, so that only those are
+// regenerated.
+typedef struct {
+  entity_handle_list_t handles;
+} selection_t;
+
+void selection_add(selection_t *selection, canvas_renderer_t *renderer,
+                   entity_t *entity) {
+  if (entity->flags & entity_flag_selected) {
+    return;
+  }
+  entity->flags |= entity_flag_selected;
+  canvas_renderer_invalidate(renderer, entity);
+  entity->selection_index = (uint32_t)selection->handles.length;
+  entity_handle_list_push(&selection->handles, &entity->handle);
+}
+
+void selection_remove(selection_t *selection, entity_store_t *store,
+                      canvas_renderer_t *renderer, entity_t *entity) {
+  if ((entity->flags & entity_flag_selected) == 0) {
+    return;
+  }
+  entity->flags &= ~entity_flag_selected;
+  canvas_renderer_invalidate(renderer, entity);
+
+  // moves the last handle into the place of the removed one
+  entity_handle_list_t *handles = &selection->handles;
+  const entity_handle_t last = handles->items[--handles->length];
+  if (entity->selection_index < handles->length) {
+    handles->items[entity->selection_index] = last;
+    entity_store_get(store, &last)->selection_index = entity->selection_index;
+  }
+}
+
+void selection_clear(selection_t *selection, entity_store_t *store,
+                     canvas_renderer_t *renderer) {
+  for (size_t i = 0; i < selection->handles.length; ++i) {
+    entity_t *entity = entity_store_get(store, selection->handles.items + i);
+    entity->flags &= ~entity_flag_selected;
+    canvas_renderer_invalidate(renderer, entity);
+  }
+  entity_handle_list_clear(&selection->handles);
+}
+
+// returns the entity at index in the selection
+entity_t *selection_get(const selection_t *selection, entity_store_t *store,
+                        size_t index) {
+  return entity_store_get(store, selection->handles.items + index);
+}
+
+// ===========================
+// struct: canvas stats
+// ===========================
+
+// counters collected while drawing a frame, shown in the metrics window
+typedef struct {
+  int drawn_entity_count;
+  int culled_entity_count;
+} canvas_stats_t;
+
+// ===========================
+// struct: stroke stats
+// ===========================
+
+// number of points of the strokes committed by the draw tool, before and after
+// simplification
+typedef struct {
+  size_t drawn_point_count;
+  size_t kept_point_count;
+} stroke_stats_t;
+
+// ===========================
+// struct: game state
+// ===========================
+
+typedef enum {
+  tool_select,
+  tool_draw,
   tool_rectangle,
   tool_text,
 } tool_t;
 
-typedef struct {
-  arena_t *arena;
+// what a press of the select tool is doing. what was pressed is hit tested
+// once, when the mouse goes down, and the rest of the gesture follows from it.
+typedef enum {
+  // the mouse is up, or went down somewhere the select tool ignores
+  select_state_idle,
+  // the mouse went down on an entity, which is now selected, and has not moved
+  select_state_pressed,
+  // the selection is being dragged by the mouse
+  select_state_moving,
+  // the mouse went down on empty space, and spans the selection area
+  select_state_area_selecting,
+} select_state_t;
 
+typedef struct {
   ImFont *fa_font;
   sg_pass_action pass_action;
 
+  // scratch memory for transient data, current for the whole of a frame. the
+  // two arenas alternate, so that what is pushed during a frame stays valid
+  // until the end of the next one.
+  arena_t *frame_arenas[2];
+  arena_t *frame_arena;
+
   window_info_t color_picker_window;
   ImVec2 color_picker_window_size;
 
-  entity_t *entities;
-  entity_t *freed_entity;
-  bool has_selected_entities;
-  entity_t *selected_entity;
-  bool is_area_selecting;
+  entity_store_t entities;
+  // buffers of removed entities and of committed strokes
+  point_pool_t point_pool;
+  text_pool_t text_pool;
+  uint32_t next_z;
+  spatial_grid_t grid;
+  // scratch list holding the candidates of the last hit test
+  entity_list_t hit_candidates;
+  bvh_t bvh;
+  selection_t selection;
+  select_state_t select_state;
+  // the area selected on the last frame of the current area selection, if
+  // there has been one, from which the next frame updates the selection
+  aabb_t selected_area;
+  bool has_selected_area;
 
   bool is_mouse_down;
   bool is_prev_mouse_down;
-  bool is_moving_entities;
-  point_list_t points;
+  // how far the selection has been dragged. selected paths and rects are drawn
+  // and hit tested displaced by it, and it is only baked into their points
+  // once the mouse is released, so that dragging does not touch their points.
+  ImVec2 drag_offset;
+  // the stroke being drawn
+  point_chunk_list_t points;
   ImVec2 drag_start;
   ImVec2 last_mouse_pos;
 
   tool_t current_tool;
+  // strokes are simplified to within this distance (in px) of the points that
+  // were drawn. 0 keeps every point.
+  float stroke_tolerance;
+  stroke_stats_t stroke_stats;
   bool is_color_picker_changing;
   ImColor picked_color;
+
+  canvas_renderer_t renderer;
+  canvas_stats_t canvas_stats;
+  // heap allocations made during the last frame
+  alloc_counter_t frame_allocs;
 } state_t;
 
+// adds an entity with room for point_count points to the store, to be put
+// into the document with push_entity once its points are set. points are
+// taken from the point pool, and must be pushed with point_pool_push.
 entity_t *entity_alloc(state_t *state, size_t point_count) {
-  entity_t *entity = state->freed_entity;
-  if (entity) {
-    state->freed_entity = state->freed_entity->next;
-  } else {
-    entity = arena_push(state->arena, sizeof(entity_t));
-    entity->points = point_list_alloc(point_count);
+  entity_t *entity = entity_store_add(&state->entities);
+  entity->points = point_pool_take(&state->point_pool, point_count);
+  entity->is_bounds_dirty = true;
+  entity_store_cold(&state->entities, entity)->id = rand();
+  return entity;
+}
+
+entity_cold_t *entity_cold(state_t *state, const entity_t *entity) {
+  return entity_store_cold(&state->entities, entity);
+}
+
+// gives a new text entity a span in the text pool, holding text
+void entity_init_text(state_t *state, entity_t *entity, const char *text) {
+  entity_cold_t *cold = entity_cold(state, entity);
+  const size_t length = strlen(text);
+
+  size_t capacity = TEXT_INITIAL_CAPACITY;
+  while (capacity <= length) {
+    capacity *= 2;
   }
 
-  entity->flags = 0;
-  entity->next = NULL;
-  entity->prev = NULL;
+  cold->text_offset = text_pool_alloc(&state->text_pool, capacity);
+  cold->text_capacity = (uint32_t)capacity;
+  memcpy(text_pool_get(&state->text_pool, cold->text_offset), text,
+         length + 1);
+}
 
-  return entity;
+// moves the text in cold to a span of at least capacity bytes at the end of
+// the text pool, and returns where the text now is
+char *entity_grow_text(state_t *state, entity_cold_t *cold, size_t capacity) {
+  size_t new_capacity = cold->text_capacity;
+  while (new_capacity < capacity) {
+    new_capacity *= 2;
+  }
+
+  const uint32_t offset = text_pool_alloc(&state->text_pool, new_capacity);
+  char *text = text_pool_get(&state->text_pool, offset);
+  memcpy(text, text_pool_get(&state->text_pool, cold->text_offset),
+         cold->text_capacity);
+  text_pool_release(&state->text_pool, cold->text_capacity);
+
+  cold->text_offset = offset;
+  cold->text_capacity = (uint32_t)new_capacity;
+  return text;
+}
+
+// copies the text of every text entity into a new text pool, dropping the
+// garbage of the current one
+void compact_text_pool(state_t *state) {
+  text_pool_t compacted = {0};
+
+  const entity_store_t *store = &state->entities;
+  for (size_t i = 0; i < store->length; ++i) {
+    entity_cold_t *cold = store->cold + i;
+    if (cold->text_capacity == 0) {
+      continue;
+    }
+
+    const uint32_t offset = text_pool_alloc(&compacted, cold->text_capacity);
+    memcpy(text_pool_get(&compacted, offset),
+           text_pool_get(&state->text_pool, cold->text_offset),
+           cold->text_capacity);
+    cold->text_offset = offset;
+  }
+
+  growable_string_free(&state->text_pool.storage);
+  state->text_pool = compacted;
 }
 
-void entity_recycle(state_t *state, entity_t *entity) {
-  entity->next = state->freed_entity;
-  entity->prev = NULL;
-  state->freed_entity = entity;
-  point_list_clear(&entity->points);
+// recomputes the cached bounds of entity if they are dirty
+const aabb_t *entity_bounds(entity_t *entity) {
+  if (entity->is_bounds_dirty) {
+    entity->bounds =
+        aabb_from_points(entity->points.items, entity->points.length);
+    entity->is_bounds_dirty = false;
+  }
+  return &entity->bounds;
 }
 
-void entity_free(entity_t *entity) { point_list_free(&entity->points); }
+// builds the segment tree of a path entity over its current points
+void entity_build_segments(state_t *state, entity_t *entity) {
+  if (entity->flags & entity_flag_path) {
+    segment_tree_build(&entity_cold(state, entity)->segments,
+                       entity->points.items, entity->points.length);
+  }
+}
 
 void push_entity(state_t *state, entity_t *entity) {
-  entity->next = state->entities;
-  if (state->entities) {
-    state->entities->prev = entity;
+  entity->z = state->next_z++;
+  entity_handle_list_push(&state->entities.z_order, &entity->handle);
+  entity_bounds(entity);
+  entity_build_segments(state, entity);
+  spatial_grid_insert(&state->grid, entity);
+  state->bvh.is_dirty = true;
+
+  canvas_renderer_push_entity(&state->renderer, entity);
+}
+
+// translates entity by delta. the cached bounds and the segment tree are
+// translated along with the points instead of being recomputed, and the entity
+// is only reinserted into the spatial grid when it moves to a different set of
+// cells.
+void move_entity(state_t *state, entity_t *entity, const ImVec2 *delta) {
+  aabb_t moved_bounds = entity->bounds;
+  aabb_move(&moved_bounds, delta);
+
+  const grid_cell_range_t old_cells = grid_cell_range(&entity->bounds);
+  const grid_cell_range_t new_cells = grid_cell_range(&moved_bounds);
+  const bool has_changed_cells = old_cells.min_x != new_cells.min_x ||
+                                 old_cells.min_y != new_cells.min_y ||
+                                 old_cells.max_x != new_cells.max_x ||
+                                 old_cells.max_y != new_cells.max_y;
+
+  if (has_changed_cells) {
+    spatial_grid_remove(&state->grid, entity);
+  }
+
+  points_translate(entity->points.items, entity->points.length, delta);
+  entity->bounds = moved_bounds;
+  segment_tree_move(&entity_cold(state, entity)->segments, delta);
+
+  if (has_changed_cells) {
+    spatial_grid_insert(&state->grid, entity);
   }
-  state->entities = entity;
+  state->bvh.is_dirty = true;
+  canvas_renderer_invalidate(&state->renderer, entity);
 }
 
-void remove_selected_entites(state_t *state) {
-  entity_t *last_removed_entity = NULL;
-  for (entity_t *entity = state->entities; entity != NULL;
-       entity = entity->next) {
-    if (last_removed_entity) {
-      entity_recycle(state, last_removed_entity);
-      last_removed_entity = NULL;
-    }
-    if (entity->flags & entity_flag_selected &&
-        (entity->flags & entity_flag_active) == 0) {
-      if (state->entities == entity) {
-        state->entities = entity->next;
-      }
-      if (entity->prev) {
-        entity->prev->next = entity->next;
-      }
-      if (entity->next) {
-        entity->next->prev = entity->prev;
-      }
-      last_removed_entity = entity;
+// whether entity is displaced by the drag offset
+bool is_entity_dragged(const entity_t *entity) {
+  return entity->flags & entity_flag_selected &&
+         entity->flags & (entity_flag_path | entity_flag_rect);
+}
+
+// moves the dragged entities by the drag offset for good, and resets it
+void bake_drag_offset(state_t *state) {
+  const ImVec2 offset = state->drag_offset;
+  if (offset.x == 0 && offset.y == 0) {
+    return;
+  }
+
+  for (size_t i = 0; i < state->selection.handles.length; ++i) {
+    entity_t *entity = selection_get(&state->selection, &state->entities, i);
+    if (is_entity_dragged(entity)) {
+      move_entity(state, entity, &offset);
     }
   }
+  state->drag_offset = (ImVec2){0, 0};
+}
 
-  if (state->entities == NULL) {
-    for (entity_t *entity = state->freed_entity; entity != NULL;
-         entity = entity->next) {
-      entity_free(entity);
+void remove_selected_entites(state_t *state) {
+  entity_store_t *store = &state->entities;
+  selection_t *selection = &state->selection;
+  // removing an entity from the selection moves the last handle into its
+  // place, which has been looked at already
+  for (size_t i = selection->handles.length; i > 0; --i) {
+    entity_t *entity = selection_get(selection, store, i - 1);
+    if (entity->flags & entity_flag_active) {
+      continue;
     }
-    state->freed_entity = NULL;
-    arena_free(state->arena);
-    state->arena = arena_alloc(ARENA_INITIAL_SIZE);
+
+    selection_remove(selection, store, &state->renderer, entity);
+    spatial_grid_remove(&state->grid, entity);
+    state->bvh.is_dirty = true;
+    canvas_renderer_remove_entity(&state->renderer, entity);
+    point_pool_release(&state->point_pool, &entity->points);
+    entity_cold_t *cold = entity_cold(state, entity);
+    text_pool_release(&state->text_pool, cold->text_capacity);
+    segment_tree_free(&cold->segments);
+    entity_store_remove(store, entity);
+  }
+  entity_store_prune_z_order(store);
+
+  if (state->text_pool.garbage > state->text_pool.storage.length / 2) {
+    compact_text_pool(state);
+  }
+
+  if (store->length == 0) {
+    point_pool_clear(&state->point_pool);
+    spatial_grid_clear(&state->grid);
+    canvas_renderer_clear(&state->renderer);
   }
+}
 
-  state->has_selected_entities = false;
+// makes the other frame arena current and releases what was pushed onto it
+// two frames ago. must be called at the start of every frame.
+void begin_frame_arena(state_t *state) {
+  state->frame_arena = state->frame_arena == state->frame_arenas[0]
+                           ? state->frame_arenas[1]
+                           : state->frame_arenas[0];
+  arena_reset(state->frame_arena);
+
+  state->renderer.overlay = (canvas_instance_list_t){
+      .arena = state->frame_arena,
+  };
 }
 
 void create_entity(state_t *state) {
@@ -384,32 +2610,50 @@ void create_entity(state_t *state) {
     break;
 
   case tool_draw: {
-    if (vec2_distance_sqr(&state->drag_start, &io->MousePos) > 100) {
-      entity_t *entity = entity_alloc(state, state->points.capacity);
-      entity->id = rand();
+    // a stroke during which the mouse did not move while the button was down
+    // recorded fewer than two points, which make no path. simplification keeps
+    // both ends of the others.
+    if (state->points.length >= 2 &&
+        vec2_distance_sqr(&state->drag_start, &io->MousePos) > 100) {
+      // the stroke is simplified where it was recorded, and only the points
+      // that are kept are copied into a pooled buffer of their size class
+      const arena_mark_t scratch_mark = arena_mark(state->frame_arena);
+      const size_t drawn_count = state->points.length;
+      bool *keep = arena_push(state->frame_arena, sizeof(bool) * drawn_count);
+      const size_t kept_count = point_chunk_list_simplify(
+          &state->points, state->stroke_tolerance, keep, state->frame_arena);
+
+      state->stroke_stats.drawn_point_count += drawn_count;
+      state->stroke_stats.kept_point_count += kept_count;
+
+      entity_t *entity = entity_alloc(state, kept_count);
       entity->flags = entity_flag_path;
-      entity->color = state->picked_color;
-      point_list_copy(&entity->points, &state->points);
+      entity->color = igColorConvertFloat4ToU32(state->picked_color.Value);
+      point_chunk_list_copy_kept(&state->points, keep, entity->points.items);
+      entity->points.length = kept_count;
+
+      arena_rewind(state->frame_arena, scratch_mark);
+
       push_entity(state, entity);
     }
 
-    point_list_clear(&state->points);
+    point_chunk_list_clear(&state->points);
 
     break;
   }
 
   case tool_rectangle: {
     if (vec2_distance_sqr(&state->drag_start, &io->MousePos) > 625) {
-      entity_t *entity = entity_alloc(state, 2);
-      entity->id = rand();
+      entity_t *entity = entity_alloc(state, 4);
       entity->flags = entity_flag_rect;
-      entity->color = state->picked_color;
+      entity->color = igColorConvertFloat4ToU32(state->picked_color.Value);
 
-      *point_list_push(&entity->points) = state->drag_start;
-      *point_list_push(&entity->points) =
+      point_pool_t *pool = &state->point_pool;
+      *point_pool_push(pool, &entity->points) = state->drag_start;
+      *point_pool_push(pool, &entity->points) =
           (ImVec2){io->MousePos.x, state->drag_start.y};
-      *point_list_push(&entity->points) = io->MousePos;
-      *point_list_push(&entity->points) =
+      *point_pool_push(pool, &entity->points) = io->MousePos;
+      *point_pool_push(pool, &entity->points) =
           (ImVec2){state->drag_start.x, io->MousePos.y};
 
       push_entity(state, entity);
@@ -421,86 +2665,192 @@ void create_entity(state_t *state) {
   case tool_text: {
     if (vec2_distance_sqr(&state->drag_start, &io->MousePos) > 625) {
       entity_t *entity = entity_alloc(state, 4);
-      entity->id = rand();
-      entity->flags = entity_flag_editable_text | entity_flag_selected;
-      entity->color = state->picked_color;
-      memcpy(entity->content, "Text", 4);
+      entity->flags = entity_flag_editable_text;
+      entity->color = igColorConvertFloat4ToU32(state->picked_color.Value);
+      entity_init_text(state, entity, "Text");
 
       ImGuiContext *gui_ctx = GImGui;
 
-      entity->dimension.x = fabs(io->MousePos.x - state->drag_start.x);
-      entity->dimension.y = fabs(io->MousePos.y - state->drag_start.y);
+      entity_cold_t *cold = entity_cold(state, entity);
+      cold->dimension.x = fabs(io->MousePos.x - state->drag_start.x);
+      cold->dimension.y = fabs(io->MousePos.y - state->drag_start.y);
 
-      *point_list_push(&entity->points) = state->drag_start;
-      *point_list_push(&entity->points) =
+      point_pool_t *pool = &state->point_pool;
+      *point_pool_push(pool, &entity->points) = state->drag_start;
+      *point_pool_push(pool, &entity->points) =
           (ImVec2){io->MousePos.x, state->drag_start.y};
-      *point_list_push(&entity->points) = io->MousePos;
-      *point_list_push(&entity->points) =
+      *point_pool_push(pool, &entity->points) = io->MousePos;
+      *point_pool_push(pool, &entity->points) =
           (ImVec2){state->drag_start.x, io->MousePos.y};
 
       push_entity(state, entity);
+      selection_add(&state->selection, &state->renderer, entity);
     }
     break;
   }
   }
 }
 
+bool is_entity_near_point(state_t *state, const entity_t *entity,
+                          const ImVec2 *mouse_pos) {
+  if (entity->flags & entity_flag_rect) {
+    ImVec2 *top_left = entity->points.items;
+    ImVec2 *bottom_right = entity->points.items + 2;
+
+    return vec2_is_in_area(mouse_pos, top_left, bottom_right);
+  }
+
+  if (entity->flags & entity_flag_path && entity->points.length > 1) {
+    const segment_tree_t *segments = &entity_cold(state, entity)->segments;
+    if (segments->run_count > 0) {
+      return segment_tree_is_near(segments, entity->points.items,
+                                  entity->points.length, mouse_pos,
+                                  SELECT_THRESHOLD);
+    }
+    return segments_distance_sqr(entity->points.items,
+                                 entity->points.length - 1, mouse_pos,
+                                 SELECT_THRESHOLD) <= SELECT_THRESHOLD;
+  }
+
+  return false;
+}
+
+// returns the topmost entity near mouse_pos. only entities whose bounds are
+// within the select threshold of mouse_pos, as reported by the spatial grid,
+// are tested. dragged entities are indexed where they were before the drag, so
+// while there is a drag offset they are looked for in a second pass, around
+// mouse_pos moved back by it.
 entity_t *find_entity_near_mouse(state_t *state, const ImVec2 *mouse_pos) {
-  for (entity_t *entity = state->entities; entity != NULL;
-       entity = entity->next) {
-    if (entity->flags & entity_flag_rect) {
-      ImVec2 *top_left = entity->points.items;
-      ImVec2 *bottom_right = entity->points.items + 2;
-
-      if (vec2_is_in_area(mouse_pos, top_left, bottom_right)) {
-        return entity;
+  const ImVec2 *offset = &state->drag_offset;
+  const bool has_offset = offset->x != 0 || offset->y != 0;
+  const ImVec2 dragged_pos = {mouse_pos->x - offset->x,
+                              mouse_pos->y - offset->y};
+
+  entity_t *found = NULL;
+  for (int pass = 0; pass < (has_offset ? 2 : 1); ++pass) {
+    const ImVec2 *pos = pass == 0 ? mouse_pos : &dragged_pos;
+    spatial_grid_query_point(&state->grid, &state->entities, pos,
+                             sqrtf(SELECT_THRESHOLD), &state->hit_candidates);
+
+    for (size_t i = 0; i < state->hit_candidates.length; ++i) {
+      entity_t *entity = state->hit_candidates.items[i];
+      if (has_offset && is_entity_dragged(entity) != (pass == 1)) {
+        continue;
       }
-    } else if (entity->flags & entity_flag_path) {
-      for (size_t i = 1; i < entity->points.length; ++i) {
-        ImVec2 *current_point = &entity->points.items[i];
-        ImVec2 *last_point = &entity->points.items[i - 1];
+      if ((found == NULL || entity->z > found->z) &&
+          is_entity_near_point(state, entity, pos)) {
+        found = entity;
+      }
+    }
+  }
+
+  return found;
+}
 
-        ImVec2 mouse_pos_proj;
-        project_point_to_segment(&mouse_pos_proj, last_point, current_point,
-                                 mouse_pos);
+// returns whether entity has a point inside area
+bool is_entity_in_area(const entity_t *entity, const aabb_t *area) {
+  return points_any_in_area(entity->points.items, entity->points.length, area);
+}
 
-        ImVec2 mouse_pos_delta_to_segment = {mouse_pos_proj.x - mouse_pos->x,
-                                             mouse_pos_proj.y - mouse_pos->y};
+// tests again the entities whose bounds intersect rect and which are selected
+// if is_selected is set, or not selected if it is not, so that those with a
+// point inside area end up selected and the others do not
+void update_selection_in_rect(state_t *state, const aabb_t *rect,
+                              const aabb_t *area, bool is_selected) {
+  selection_t *selection = &state->selection;
+  const bvh_t *bvh = &state->bvh;
+
+  uint32_t stack[BVH_MAX_DEPTH * 2];
+  size_t stack_size = 0;
+  if (bvh->node_count > 0) {
+    stack[stack_size++] = 0;
+  }
 
-        float magnitude_sqr = vec2_magnitude_sqr(&mouse_pos_delta_to_segment);
-        if (magnitude_sqr <= SELECT_THRESHOLD) {
-          return entity;
-        }
+  while (stack_size > 0) {
+    const bvh_node_t *node = &bvh->nodes[stack[--stack_size]];
+    entity_t **items = bvh->entities.items + node->first;
+
+    if (!aabb_intersects(&node->bounds, rect)) {
+      continue;
+    }
+
+    if (aabb_contains(area, &node->bounds)) {
+      for (uint32_t i = 0; i < node->count; ++i) {
+        selection_add(selection, &state->renderer, items[i]);
       }
+      continue;
+    }
+
+    if (!aabb_intersects(&node->bounds, area)) {
+      for (uint32_t i = 0; i < node->count; ++i) {
+        selection_remove(selection, &state->entities, &state->renderer,
+                         items[i]);
+      }
+      continue;
+    }
+
+    if (node->left != 0) {
+      stack[stack_size++] = node->left;
+      stack[stack_size++] = node->left + 1;
+      continue;
     }
-  }
 
-  return NULL;
+    for (uint32_t i = 0; i < node->count; ++i) {
+      entity_t *entity = items[i];
+      if (((entity->flags & entity_flag_selected) != 0) != is_selected ||
+          !aabb_intersects(&entity->bounds, rect)) {
+        continue;
+      }
+      if (aabb_contains(area, &entity->bounds) ||
+          (aabb_intersects(area, &entity->bounds) &&
+           is_entity_in_area(entity, area))) {
+        selection_add(selection, &state->renderer, entity);
+      } else {
+        selection_remove(selection, &state->entities, &state->renderer,
+                         entity);
+      }
+    }
+  }
 }
 
+// makes the selection the entities with a point inside the area spanned by
+// top_left and bottom_right. entities are found through the bvh: subtrees
+// entirely inside the area are selected without looking at their points.
+// while an area selection goes on, only the entities around the difference
+// between the last area and this one can change, so only they are looked at.
 void select_entities_in_area(state_t *state, const ImVec2 *top_left,
                              const ImVec2 *bottom_right) {
-  bool has_selected_entities = false;
-
-  for (entity_t *entity = state->entities; entity != NULL;
-       entity = entity->next) {
-    const size_t no_of_points = entity->points.length;
-    bool found = false;
-    for (size_t i = 0; i < no_of_points; ++i) {
-      if (vec2_is_in_area(entity->points.items + i, top_left, bottom_right)) {
-        found = true;
-        break;
-      }
+  selection_t *selection = &state->selection;
+  const aabb_t area = aabb_from_corners(top_left, bottom_right);
+
+  if (state->bvh.is_dirty) {
+    bvh_build(&state->bvh, &state->entities);
+    // every entity may end up selected, so make room for all of them now
+    // instead of growing the selection while dragging
+    entity_handle_list_reserve(&selection->handles, state->entities.capacity);
+    state->has_selected_area = false;
+  }
+
+  if (!state->has_selected_area) {
+    selection_clear(selection, &state->entities, &state->renderer);
+    update_selection_in_rect(state, &area, &area, false);
+  } else {
+    // a selected entity can only lose its selection if it has a point in the
+    // part of the last area that is now left out, and an entity that is not
+    // selected can only gain it if it has one in the part that is new
+    aabb_t changed[4];
+    size_t changed_count = aabb_subtract(&state->selected_area, &area, changed);
+    for (size_t i = 0; i < changed_count; ++i) {
+      update_selection_in_rect(state, changed + i, &area, true);
     }
-    if (found) {
-      has_selected_entities = true;
-      entity->flags |= entity_flag_selected;
-    } else {
-      entity->flags &= ~entity_flag_selected;
+    changed_count = aabb_subtract(&area, &state->selected_area, changed);
+    for (size_t i = 0; i < changed_count; ++i) {
+      update_selection_in_rect(state, changed + i, &area, false);
     }
   }
 
-  state->has_selected_entities = has_selected_entities;
+  state->selected_area = area;
+  state->has_selected_area = true;
 }
 
 // ============================================================================
@@ -527,6 +2877,518 @@ bool selectable_button(const char *label, const ImVec2 size,
   return clicked;
 }
 
+// ============================================================================
+// canvas renderer
+// ============================================================================
+
+// every instance is drawn as a triangle strip over these corners
+static const ImVec2 canvas_corners[4] = {{0, 0}, {1, 0}, {0, 1}, {1, 1}};
+
+typedef struct {
+  // maps canvas coordinates (in px) to clip space
+  ImVec2 ndc_scale;
+  ImVec2 drag_offset;
+} canvas_vs_params_t;
+
+static const char *canvas_glsl_vs =
+    "#version 410\n"
+    "uniform vec4 vs_params[1];\n"
+    "layout(location = 0) in vec2 corner;\n"
+    "layout(location = 1) in vec2 inst_a;\n"
+    "layout(location = 2) in vec2 inst_b;\n"
+    "layout(location = 3) in float inst_radius;\n"
+    "layout(location = 4) in vec4 inst_color;\n"
+    "layout(location = 5) in float inst_dragged;\n"
+    "out vec2 pos;\n"
+    "flat out vec2 seg_a;\n"
+    "flat out vec2 seg_b;\n"
+    "flat out float radius;\n"
+    "flat out vec4 color;\n"
+    "void main() {\n"
+    "  vec2 offset = vs_params[0].zw * inst_dragged;\n"
+    "  vec2 a = inst_a + offset;\n"
+    "  vec2 b = inst_b + offset;\n"
+    "  vec2 p;\n"
+    "  if (inst_radius > 0.0) {\n"
+    "    vec2 d = b - a;\n"
+    "    float len = length(d);\n"
+    "    vec2 dir = len > 0.0 ? d / len : vec2(1.0, 0.0);\n"
+    "    vec2 normal = vec2(-dir.y, dir.x);\n"
+    "    float r = inst_radius + 1.0;\n"
+    "    p = mix(a - dir * r, b + dir * r, corner.x) +\n"
+    "        normal * r * (corner.y * 2.0 - 1.0);\n"
+    "  } else {\n"
+    "    p = mix(a, b, corner);\n"
+    "  }\n"
+    "  pos = p;\n"
+    "  seg_a = a;\n"
+    "  seg_b = b;\n"
+    "  radius = inst_radius;\n"
+    "  color = inst_color;\n"
+    "  gl_Position = vec4(p.x * vs_params[0].x - 1.0,\n"
+    "                     1.0 - p.y * vs_params[0].y, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *canvas_glsl_fs =
+    "#version 410\n"
+    "in vec2 pos;\n"
+    "flat in vec2 seg_a;\n"
+    "flat in vec2 seg_b;\n"
+    "flat in float radius;\n"
+    "flat in vec4 color;\n"
+    "out vec4 frag_color;\n"
+    "void main() {\n"
+    "  float alpha = 1.0;\n"
+    "  if (radius > 0.0) {\n"
+    "    vec2 pa = pos - seg_a;\n"
+    "    vec2 ba = seg_b - seg_a;\n"
+    "    float h = clamp(dot(pa, ba) / max(dot(ba, ba), 1e-6), 0.0, 1.0);\n"
+    "    alpha = clamp(radius - length(pa - ba * h) + 0.5, 0.0, 1.0);\n"
+    "  }\n"
+    "  frag_color = vec4(color.rgb, color.a * alpha);\n"
+    "}\n";
+
+static const char *canvas_msl_vs =
+    "#include <metal_stdlib>\n"
+    "using namespace metal;\n"
+    "struct vs_params { float4 params; };\n"
+    "struct vs_in {\n"
+    "  float2 corner [[attribute(0)]];\n"
+    "  float2 inst_a [[attribute(1)]];\n"
+    "  float2 inst_b [[attribute(2)]];\n"
+    "  float inst_radius [[attribute(3)]];\n"
+    "  float4 inst_color [[attribute(4)]];\n"
+    "  float inst_dragged [[attribute(5)]];\n"
+    "};\n"
+    "struct vs_out {\n"
+    "  float4 position [[position]];\n"
+    "  float2 pos;\n"
+    "  float2 seg_a [[flat]];\n"
+    "  float2 seg_b [[flat]];\n"
+    "  float radius [[flat]];\n"
+    "  float4 color [[flat]];\n"
+    "};\n"
+    "vertex vs_out vs_main(vs_in in [[stage_in]],\n"
+    "                      constant vs_params &u [[buffer(0)]]) {\n"
+    "  float2 offset = u.params.zw * in.inst_dragged;\n"
+    "  float2 a = in.inst_a + offset;\n"
+    "  float2 b = in.inst_b + offset;\n"
+    "  float2 p;\n"
+    "  if (in.inst_radius > 0.0) {\n"
+    "    float2 d = b - a;\n"
+    "    float len = length(d);\n"
+    "    float2 dir = len > 0.0 ? d / len : float2(1.0, 0.0);\n"
+    "    float2 normal = float2(-dir.y, dir.x);\n"
+    "    float r = in.inst_radius + 1.0;\n"
+    "    p = mix(a - dir * r, b + dir * r, in.corner.x) +\n"
+    "        normal * r * (in.corner.y * 2.0 - 1.0);\n"
+    "  } else {\n"
+    "    p = mix(a, b, in.corner);\n"
+    "  }\n"
+    "  vs_out out;\n"
+    "  out.pos = p;\n"
+    "  out.seg_a = a;\n"
+    "  out.seg_b = b;\n"
+    "  out.radius = in.inst_radius;\n"
+    "  out.color = in.inst_color;\n"
+    "  out.position = float4(p.x * u.params.x - 1.0,\n"
+    "                        1.0 - p.y * u.params.y, 0.0, 1.0);\n"
+    "  return out;\n"
+    "}\n";
+
+static const char *canvas_msl_fs =
+    "#include <metal_stdlib>\n"
+    "using namespace metal;\n"
+    "struct vs_out {\n"
+    "  float4 position [[position]];\n"
+    "  float2 pos;\n"
+    "  float2 seg_a [[flat]];\n"
+    "  float2 seg_b [[flat]];\n"
+    "  float radius [[flat]];\n"
+    "  float4 color [[flat]];\n"
+    "};\n"
+    "fragment float4 fs_main(vs_out in [[stage_in]]) {\n"
+    "  float alpha = 1.0;\n"
+    "  if (in.radius > 0.0) {\n"
+    "    float2 pa = in.pos - in.seg_a;\n"
+    "    float2 ba = in.seg_b - in.seg_a;\n"
+    "    float h = clamp(dot(pa, ba) / max(dot(ba, ba), 1e-6), 0.0, 1.0);\n"
+    "    alpha = clamp(in.radius - length(pa - ba * h) + 0.5, 0.0, 1.0);\n"
+    "  }\n"
+    "  return float4(in.color.rgb, in.color.a * alpha);\n"
+    "}\n";
+
+static sg_shader canvas_renderer_make_shader(void) {
+  sg_shader_desc desc = {
+      .uniform_blocks[0] =
+          {
+              .stage = SG_SHADERSTAGE_VERTEX,
+              .size = sizeof(canvas_vs_params_t),
+              .msl_buffer_n = 0,
+              .glsl_uniforms[0] =
+                  {
+                      .type = SG_UNIFORMTYPE_FLOAT4,
+                      .array_count = 1,
+                      .glsl_name = "vs_params",
+                  },
+          },
+      .label = "canvas-shader",
+  };
+
+  switch (sg_query_backend()) {
+  case SG_BACKEND_METAL_IOS:
+  case SG_BACKEND_METAL_MACOS:
+  case SG_BACKEND_METAL_SIMULATOR:
+    desc.vertex_func = (sg_shader_function){canvas_msl_vs, "vs_main"};
+    desc.fragment_func = (sg_shader_function){canvas_msl_fs, "fs_main"};
+    break;
+
+  case SG_BACKEND_GLCORE:
+  case SG_BACKEND_DUMMY:
+    desc.vertex_func.source = canvas_glsl_vs;
+    desc.fragment_func.source = canvas_glsl_fs;
+    break;
+
+  default:
+    // build.sh only builds for the backends above
+    fprintf(stderr, "the canvas renderer does not support this backend\n");
+    exit(1);
+  }
+
+  return sg_make_shader(&desc);
+}
+
+static void canvas_renderer_init(canvas_renderer_t *renderer) {
+  renderer->pipeline = sg_make_pipeline(&(sg_pipeline_desc){
+      .shader = canvas_renderer_make_shader(),
+      .layout =
+          {
+              .buffers =
+                  {
+                      [0] = {.stride = sizeof(ImVec2)},
+                      [1] =
+                          {
+                              .stride = sizeof(canvas_instance_t),
+                              .step_func = SG_VERTEXSTEP_PER_INSTANCE,
+                          },
+                  },
+              .attrs =
+                  {
+                      [0] = {.buffer_index = 0,
+                             .format = SG_VERTEXFORMAT_FLOAT2},
+                      [1] = {.buffer_index = 1,
+                             .offset = offsetof(canvas_instance_t, a),
+                             .format = SG_VERTEXFORMAT_FLOAT2},
+                      [2] = {.buffer_index = 1,
+                             .offset = offsetof(canvas_instance_t, b),
+                             .format = SG_VERTEXFORMAT_FLOAT2},
+                      [3] = {.buffer_index = 1,
+                             .offset = offsetof(canvas_instance_t, radius),
+                             .format = SG_VERTEXFORMAT_FLOAT},
+                      [4] = {.buffer_index = 1,
+                             .offset = offsetof(canvas_instance_t, color),
+                             .format = SG_VERTEXFORMAT_UBYTE4N},
+                      [5] = {.buffer_index = 1,
+                             .offset = offsetof(canvas_instance_t, dragged),
+                             .format = SG_VERTEXFORMAT_FLOAT},
+                  },
+          },
+      .primitive_type = SG_PRIMITIVETYPE_TRIANGLE_STRIP,
+      .colors[0].blend =
+          {
+              .enabled = true,
+              .src_factor_rgb = SG_BLENDFACTOR_SRC_ALPHA,
+              .dst_factor_rgb = SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+              .src_factor_alpha = SG_BLENDFACTOR_ONE,
+              .dst_factor_alpha = SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+          },
+      .label = "canvas-pipeline",
+  });
+
+  renderer->corner_buffer = sg_make_buffer(&(sg_buffer_desc){
+      .data = SG_RANGE(canvas_corners),
+      .label = "canvas-corners",
+  });
+}
+
+static void canvas_renderer_shutdown(canvas_renderer_t *renderer) {
+  canvas_instance_list_free(&renderer->committed);
+  canvas_instance_list_free(&renderer->scratch);
+  canvas_instance_list_free(&renderer->overlay);
+  entity_handle_list_free(&renderer->dirty_entities);
+  entity_list_free(&renderer->visible_entities);
+}
+
+// makes sure buffer can hold count instances, replacing it with a larger
+// buffer if it cannot. returns whether the buffer was replaced, in which case
+// its previous content is lost.
+static bool canvas_renderer_reserve(sg_buffer *buffer, size_t *capacity,
+                                    size_t count, sg_usage usage,
+                                    const char *label) {
+  if (*capacity >= count && buffer->id != 0) {
+    return false;
+  }
+
+  size_t new_capacity = *capacity ? *capacity : CANVAS_BUFFER_INITIAL_CAPACITY;
+  while (new_capacity < count) {
+    new_capacity *= 2;
+  }
+
+  if (buffer->id != 0) {
+    sg_destroy_buffer(*buffer);
+  }
+  *buffer = sg_make_buffer(&(sg_buffer_desc){
+      .size = sizeof(canvas_instance_t) * new_capacity,
+      .usage = usage,
+      .label = label,
+  });
+  *capacity = new_capacity;
+
+  return true;
+}
+
+// regenerates the instances of the dirty entities in place. entities whose
+// number of instances changed stay dirty and require committed to be
+// compacted.
+static void canvas_renderer_update_dirty(canvas_renderer_t *renderer,
+                                         const entity_store_t *store) {
+  for (size_t i = 0; i < renderer->dirty_entities.length; ++i) {
+    entity_t *entity =
+        entity_store_get(store, renderer->dirty_entities.items + i);
+
+    canvas_instance_list_clear(&renderer->scratch);
+    canvas_instance_list_push_entity(&renderer->scratch, entity);
+    if (renderer->scratch.length != entity->instance_count) {
+      renderer->is_committed_stale = true;
+      continue;
+    }
+
+    memcpy(renderer->committed.items + entity->instance_first,
+           renderer->scratch.items,
+           sizeof(canvas_instance_t) * entity->instance_count);
+    entity->is_geometry_dirty = false;
+    renderer->is_committed_dirty = true;
+  }
+  entity_handle_list_clear(&renderer->dirty_entities);
+}
+
+// copies the instances of every entity in the document into a new committed,
+// bottom to top, dropping the hidden instances of removed entities. entities
+// that are still dirty are regenerated.
+static void canvas_renderer_compact(canvas_renderer_t *renderer,
+                                    const entity_store_t *store) {
+  canvas_instance_list_t *compacted = &renderer->scratch;
+  canvas_instance_list_clear(compacted);
+
+  for (size_t i = 0; i < store->z_order.length; ++i) {
+    entity_t *entity = entity_store_get(store, store->z_order.items + i);
+    const size_t first = compacted->length;
+    if (entity->is_geometry_dirty) {
+      canvas_instance_list_push_entity(compacted, entity);
+      entity->is_geometry_dirty = false;
+    } else {
+      memcpy(canvas_instance_list_push_n(compacted, entity->instance_count),
+             renderer->committed.items + entity->instance_first,
+             sizeof(canvas_instance_t) * entity->instance_count);
+    }
+    entity->instance_first = first;
+    entity->instance_count = compacted->length - first;
+  }
+
+  const canvas_instance_list_t previous = renderer->committed;
+  renderer->committed = *compacted;
+  *compacted = previous;
+
+  renderer->hole_count = 0;
+  renderer->is_committed_stale = false;
+  renderer->is_committed_dirty = true;
+}
+
+// uploads whatever has changed since the last frame. must be called once per
+// frame, outside of a pass.
+static void canvas_renderer_upload(canvas_renderer_t *renderer,
+                                   const entity_store_t *store) {
+  renderer->uploaded_bytes = 0;
+
+  canvas_renderer_update_dirty(renderer, store);
+  if (renderer->hole_count > renderer->committed.length / 2) {
+    renderer->is_committed_stale = true;
+  }
+  if (renderer->is_committed_stale) {
+    canvas_renderer_compact(renderer, store);
+  }
+
+  // sokol_gfx can only replace the content of a dynamic buffer as a whole, so
+  // committed is uploaded in full, but only on frames in which it changed
+  if (canvas_renderer_reserve(&renderer->committed_buffer,
+                              &renderer->committed_buffer_capacity,
+                              renderer->committed.length, SG_USAGE_DYNAMIC,
+                              "canvas-committed")) {
+    renderer->is_committed_dirty = true;
+  }
+  if (renderer->is_committed_dirty && renderer->committed.length > 0) {
+    const size_t size = sizeof(canvas_instance_t) * renderer->committed.length;
+    sg_update_buffer(renderer->committed_buffer,
+                     &(sg_range){renderer->committed.items, size});
+    renderer->uploaded_bytes += size;
+  }
+  renderer->is_committed_dirty = false;
+
+  canvas_renderer_reserve(&renderer->overlay_buffer,
+                          &renderer->overlay_buffer_capacity,
+                          renderer->overlay.length, SG_USAGE_STREAM,
+                          "canvas-overlay");
+  if (renderer->overlay.length > 0) {
+    const size_t size = sizeof(canvas_instance_t) * renderer->overlay.length;
+    renderer->overlay_buffer_offset =
+        sg_append_buffer(renderer->overlay_buffer,
+                         &(sg_range){renderer->overlay.items, size});
+    renderer->uploaded_bytes += size;
+  }
+}
+
+static int canvas_renderer_compare_instances(const void *a, const void *b) {
+  const entity_t *entity_a = *(entity_t *const *)a;
+  const entity_t *entity_b = *(entity_t *const *)b;
+  return (entity_a->instance_first > entity_b->instance_first) -
+         (entity_a->instance_first < entity_b->instance_first);
+}
+
+// draws count committed instances starting at first
+static void canvas_renderer_draw_committed(canvas_renderer_t *renderer,
+                                           uint32_t first, uint32_t count) {
+  sg_apply_bindings(&(sg_bindings){
+      .vertex_buffers =
+          {
+              [0] = renderer->corner_buffer,
+              [1] = renderer->committed_buffer,
+          },
+      .vertex_buffer_offsets[1] = (int)(sizeof(canvas_instance_t) * first),
+  });
+  sg_draw(0, 4, (int)count);
+  renderer->drawn_instance_count += count;
+  ++renderer->draw_call_count;
+}
+
+// draws the visible part of the document and then the overlay. must be called
+// inside the swapchain pass, after canvas_renderer_upload, which may move the
+// instances of entities.
+static void canvas_renderer_draw(canvas_renderer_t *renderer,
+                                 const ImVec2 *display_size) {
+  renderer->drawn_instance_count = 0;
+  renderer->draw_call_count = 0;
+  if (renderer->visible_entities.length == 0 &&
+      renderer->overlay.length == 0) {
+    return;
+  }
+
+  sg_apply_pipeline(renderer->pipeline);
+
+  const canvas_vs_params_t vs_params = {
+      .ndc_scale = {2 / display_size->x, 2 / display_size->y},
+      .drag_offset = renderer->drag_offset,
+  };
+  sg_apply_uniforms(0, &SG_RANGE(vs_params));
+
+  // instances are committed bottom to top, so drawing the visible ones in
+  // the order of their instances keeps the stacking order. neighbouring
+  // ranges are merged into a single draw.
+  entity_list_t *visible = &renderer->visible_entities;
+  qsort(visible->items, visible->length, sizeof(entity_t *),
+        canvas_renderer_compare_instances);
+
+  uint32_t first = 0;
+  uint32_t end = 0;
+  for (size_t i = 0; i < visible->length; ++i) {
+    const entity_t *entity = visible->items[i];
+    if (entity->instance_count == 0) {
+      continue;
+    }
+    if (end == first) {
+      first = entity->instance_first;
+    } else if (entity->instance_first - end >= CANVAS_CULL_MIN_GAP) {
+      canvas_renderer_draw_committed(renderer, first, end - first);
+      first = entity->instance_first;
+    }
+    end = entity->instance_first + entity->instance_count;
+  }
+  if (end > first) {
+    canvas_renderer_draw_committed(renderer, first, end - first);
+  }
+
+  if (renderer->overlay.length > 0) {
+    sg_apply_bindings(&(sg_bindings){
+        .vertex_buffers =
+            {
+                [0] = renderer->corner_buffer,
+                [1] = renderer->overlay_buffer,
+            },
+        .vertex_buffer_offsets[1] = renderer->overlay_buffer_offset,
+    });
+    sg_draw(0, 4, (int)renderer->overlay.length);
+  }
+}
+
+// ============================================================================
+// platform
+// ============================================================================
+
+#if defined(IMDRAW_HEADLESS)
+
+// headless builds have no window. the canvas is a fixed size surface that
+// only exists as far as the dummy backend is concerned.
+#define HEADLESS_WIDTH 1280
+#define HEADLESS_HEIGHT 720
+
+static sg_environment platform_environment(void) {
+  return (sg_environment){
+      .defaults =
+          {
+              .color_format = SG_PIXELFORMAT_RGBA8,
+              .depth_format = SG_PIXELFORMAT_DEPTH_STENCIL,
+              .sample_count = 1,
+          },
+  };
+}
+
+static sg_swapchain platform_swapchain(void) {
+  return (sg_swapchain){
+      .width = HEADLESS_WIDTH,
+      .height = HEADLESS_HEIGHT,
+      .sample_count = 1,
+      .color_format = SG_PIXELFORMAT_RGBA8,
+      .depth_format = SG_PIXELFORMAT_DEPTH_STENCIL,
+  };
+}
+
+static simgui_frame_desc_t platform_frame_desc(void) {
+  return (simgui_frame_desc_t){
+      .width = HEADLESS_WIDTH,
+      .height = HEADLESS_HEIGHT,
+      .delta_time = 1.0 / 60.0,
+      .dpi_scale = 1,
+  };
+}
+
+#else
+
+static sg_environment platform_environment(void) {
+  return sglue_environment();
+}
+
+static sg_swapchain platform_swapchain(void) { return sglue_swapchain(); }
+
+static simgui_frame_desc_t platform_frame_desc(void) {
+  return (simgui_frame_desc_t){
+      .width = sapp_width(),
+      .height = sapp_height(),
+      .delta_time = sapp_frame_duration(),
+      .dpi_scale = sapp_dpi_scale(),
+  };
+}
+
+#endif
+
 // ============================================================================
 // main program logic
 // ============================================================================
@@ -535,7 +3397,7 @@ static state_t state;
 
 static void init(void) {
   sg_setup(&(sg_desc){
-      .environment = sglue_environment(),
+      .environment = platform_environment(),
       .logger.func = slog_func,
   });
   simgui_setup(&(simgui_desc_t){
@@ -556,31 +3418,42 @@ static void init(void) {
   state.fa_font = ImFontAtlas_AddFontFromMemoryTTF(
       io->Fonts, fa4_ttf, FA4_TTF_SIZE, 16.0f, config, icon_ranges);
 
-  state.arena = arena_alloc(ARENA_INITIAL_SIZE);
-  state.points = point_list_alloc(100);
+  entity_store_init(&state.entities);
+  point_pool_init(&state.point_pool);
+  for (int i = 0; i < 2; ++i) {
+    // frame arenas are used every frame, so give each its first page up front
+    // rather than on whichever frame first needs scratch memory
+    state.frame_arenas[i] = arena_alloc(FRAME_ARENA_PAGE_SIZE);
+    arena_push(state.frame_arenas[i], 0);
+    arena_reset(state.frame_arenas[i]);
+  }
   state.last_mouse_pos.x = 0;
   state.last_mouse_pos.y = 0;
   state.is_mouse_down = false;
   state.pass_action.colors[0].load_action = SG_LOADACTION_CLEAR;
-  state.selected_entity = NULL;
-  state.has_selected_entities = false;
+  const ImVec4 *window_bg = &igGetStyle()->Colors[ImGuiCol_WindowBg];
+  state.pass_action.colors[0].clear_value =
+      (sg_color){window_bg->x, window_bg->y, window_bg->z, 1};
   state.current_tool = tool_select;
+  state.stroke_tolerance = STROKE_SIMPLIFY_TOLERANCE;
   state.picked_color = *ImColor_ImColor_U32(0xFFFFFFFF);
   state.color_picker_window_size.x = 0;
   state.color_picker_window_size.y = 0;
+
+  canvas_renderer_init(&state.renderer);
 }
 
 static void toolbox_window(void);
 static void color_picker_window(void);
+static void metrics_window(void);
 static int on_input_text_event(ImGuiInputTextCallbackData *event);
 
 static void frame(void) {
-  simgui_new_frame(&(simgui_frame_desc_t){
-      .width = sapp_width(),
-      .height = sapp_height(),
-      .delta_time = sapp_frame_duration(),
-      .dpi_scale = sapp_dpi_scale(),
-  });
+  const alloc_counter_t frame_start_allocs = total_allocs;
+  begin_frame_arena(&state);
+
+  const simgui_frame_desc_t frame_desc = platform_frame_desc();
+  simgui_new_frame(&frame_desc);
 
   struct ImGuiViewport *viewport = igGetMainViewport();
 
@@ -590,12 +3463,15 @@ static void frame(void) {
   igPushStyleVar_Float(ImGuiStyleVar_WindowRounding, 0.0f);
   igPushStyleVar_Float(ImGuiStyleVar_WindowBorderSize, 0.0f);
 
+  // the canvas background is the clear color of the pass, since the canvas
+  // renderer draws before imgui
   igBegin("canvas", 0,
           ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoResize |
-              ImGuiWindowFlags_NoBringToFrontOnFocus);
+              ImGuiWindowFlags_NoBringToFrontOnFocus |
+              ImGuiWindowFlags_NoBackground);
 
-  ImDrawList *draw_list = igGetWindowDrawList();
   ImGuiIO *io = igGetIO();
+  canvas_instance_list_t *overlay = &state.renderer.overlay;
 
   igInvisibleButton("canvas", viewport->WorkSize, ImGuiButtonFlags_None);
 
@@ -609,6 +3485,10 @@ static void frame(void) {
     }
   } else {
     state.is_mouse_down = false;
+    if (state.select_state == select_state_moving) {
+      bake_drag_offset(&state);
+    }
+    state.select_state = select_state_idle;
     if (state.is_prev_mouse_down) {
       create_entity(&state);
       if (state.current_tool == tool_text) {
@@ -618,52 +3498,63 @@ static void frame(void) {
     state.is_prev_mouse_down = false;
   }
 
-  ImVec2 move_entity_by = {0, 0};
   entity_t *selected_entity = NULL;
-  bool should_clear_prev_selections = false;
-  ImU32 current_picked_color = igGetColorU32_Vec4(state.picked_color.Value);
+  ImU32 current_picked_color =
+      igColorConvertFloat4ToU32(state.picked_color.Value);
 
   switch (state.current_tool) {
   default:
     break;
 
   case tool_select: {
-    if (state.is_mouse_down &&
-        !vec2_is_in_area(&io->MousePos,
-                         &state.color_picker_window.position_top_left,
-                         &state.color_picker_window.position_bottom_right)) {
-      if (!state.is_prev_mouse_down) {
-        selected_entity = find_entity_near_mouse(&state, &io->MousePos);
-        if (selected_entity) {
-          if ((selected_entity->flags & entity_flag_selected) == 0) {
-            should_clear_prev_selections = true;
-            selected_entity->flags |= entity_flag_selected;
-          }
-          state.has_selected_entities = true;
-        } else {
-          should_clear_prev_selections = true;
-          state.has_selected_entities = false;
-        }
-      } else if (state.has_selected_entities && !state.is_area_selecting) {
-        selected_entity = find_entity_near_mouse(&state, &io->MousePos);
-        if ((selected_entity &&
-             selected_entity->flags & entity_flag_selected) ||
-            state.is_moving_entities) {
-          state.is_moving_entities = true;
-          move_entity_by.x = io->MousePos.x - state.last_mouse_pos.x;
-          move_entity_by.y = io->MousePos.y - state.last_mouse_pos.y;
-        }
-      } else if (!state.is_moving_entities) {
-        state.is_area_selecting = true;
-        select_entities_in_area(&state, &state.drag_start, &io->MousePos);
+    if (!state.is_mouse_down) {
+      break;
+    }
+
+    if (!state.is_prev_mouse_down) {
+      if (vec2_is_in_area(&io->MousePos,
+                          &state.color_picker_window.position_top_left,
+                          &state.color_picker_window.position_bottom_right)) {
+        break;
       }
-    } else {
-      if (state.is_area_selecting) {
-        state.is_area_selecting = false;
+
+      // clicking an entity outside of the selection selects only it, and
+      // clicking empty space clears the selection
+      selected_entity = find_entity_near_mouse(&state, &io->MousePos);
+      if (selected_entity == NULL ||
+          (selected_entity->flags & entity_flag_selected) == 0) {
+        selection_clear(&state.selection, &state.entities, &state.renderer);
       }
-      if (state.is_moving_entities) {
-        state.is_moving_entities = false;
+      if (selected_entity != NULL) {
+        selection_add(&state.selection, &state.renderer, selected_entity);
+        state.select_state = select_state_pressed;
+      } else {
+        state.select_state = select_state_area_selecting;
+        state.has_selected_area = false;
+      }
+      break;
+    }
+
+    switch (state.select_state) {
+    case select_state_idle:
+      break;
+
+    case select_state_pressed:
+      if (io->MousePos.x == state.drag_start.x &&
+          io->MousePos.y == state.drag_start.y) {
+        break;
       }
+      state.select_state = select_state_moving;
+      // fallthrough
+
+    case select_state_moving:
+      state.drag_offset.x += io->MousePos.x - state.last_mouse_pos.x;
+      state.drag_offset.y += io->MousePos.y - state.last_mouse_pos.y;
+      break;
+
+    case select_state_area_selecting:
+      select_entities_in_area(&state, &state.drag_start, &io->MousePos);
+      break;
     }
     break;
   }
@@ -702,82 +3593,50 @@ static void frame(void) {
   igSetNextWindowCollapsed(true, ImGuiCond_Once);
   igShowMetricsWindow(NULL);
 
-  //======= draw entities to canvas =========
-
-  for (entity_t *entity = state.entities; entity != NULL;
-       entity = entity->next) {
-    bool is_selected;
-    if (should_clear_prev_selections && entity != selected_entity) {
-      is_selected = false;
-      entity->flags &= ~entity_flag_selected;
-    } else {
-      is_selected = entity->flags & entity_flag_selected;
-    }
+  //======= draw entities to canvas =========
 
-    igPushID_Int(entity->id);
-    printf("entity id %d\n", entity->id);
+  // entities whose bounds fall outside of the viewport are not drawn: text
+  // widgets are skipped, and the renderer only draws the instances of the
+  // entities marked visible.
+  const aabb_t visible_area = {
+      {viewport->WorkPos.x - CULL_MARGIN, viewport->WorkPos.y - CULL_MARGIN},
+      {viewport->WorkPos.x + viewport->WorkSize.x + CULL_MARGIN,
+       viewport->WorkPos.y + viewport->WorkSize.y + CULL_MARGIN},
+  };
 
-    if (entity->flags & entity_flag_path) {
-      ImU32 fill_color;
-      if (is_selected && state.is_color_picker_changing) {
-        fill_color = current_picked_color;
-        entity->color = state.picked_color;
-      } else {
-        fill_color = igGetColorU32_Vec4(entity->color.Value);
+  if (state.is_color_picker_changing) {
+    for (size_t i = 0; i < state.selection.handles.length; ++i) {
+      entity_t *entity = selection_get(&state.selection, &state.entities, i);
+      if (entity->color != current_picked_color) {
+        entity->color = current_picked_color;
+        canvas_renderer_invalidate(&state.renderer, entity);
       }
+    }
+  }
+  state.renderer.drag_offset = state.drag_offset;
 
-      const size_t no_of_points = entity->points.length;
-      for (size_t i = 1; i < no_of_points; ++i) {
-        ImVec2 *current_point = &entity->points.items[i];
-        ImVec2 *last_point = &entity->points.items[i - 1];
-
-        if (is_selected) {
-          if (i == 1) {
-            vec2_move(last_point, &move_entity_by);
-          }
-          vec2_move(current_point, &move_entity_by);
-        }
+  state.canvas_stats = (canvas_stats_t){0};
+  canvas_renderer_begin_culling(&state.renderer, &state.entities);
 
-        ImDrawList_AddLine(draw_list, *last_point, *current_point, fill_color,
-                           2);
-
-        if (is_selected) {
-          if (i == 1) {
-            ImDrawList_AddCircleFilled(draw_list, *last_point, 4, 0xFFFFFFFF,
-                                       10);
-          } else if (i == no_of_points - 1) {
-            ImDrawList_AddCircleFilled(draw_list, *current_point, 4, 0xFFFFFFFF,
-                                       10);
-          }
-        }
-      }
-    } else if (entity->flags & entity_flag_rect) {
-      if (is_selected) {
-        vec2_move(entity->points.items, &move_entity_by);
-        vec2_move(entity->points.items + 1, &move_entity_by);
-        vec2_move(entity->points.items + 2, &move_entity_by);
-        vec2_move(entity->points.items + 3, &move_entity_by);
-      }
+  for (size_t i = 0; i < state.entities.length; ++i) {
+    entity_t *entity = state.entities.items + i;
 
-      ImU32 fill_color;
-      if (is_selected && state.is_color_picker_changing) {
-        fill_color = current_picked_color;
-        entity->color = state.picked_color;
-      } else {
-        fill_color = igGetColorU32_Vec4(entity->color.Value);
-      }
+    // dragged entities are drawn displaced by the drag offset
+    aabb_t bounds = entity->bounds;
+    if (is_entity_dragged(entity)) {
+      aabb_move(&bounds, &state.drag_offset);
+    }
+    if (!aabb_intersects(&bounds, &visible_area)) {
+      ++state.canvas_stats.culled_entity_count;
+      continue;
+    }
+    ++state.canvas_stats.drawn_entity_count;
+    canvas_renderer_mark_visible(&state.renderer, entity);
 
-      ImDrawList_AddRectFilled(draw_list, entity->points.items[0],
-                               entity->points.items[2], fill_color, 0.0,
-                               ImDrawFlags_None);
+    if (entity->flags & entity_flag_editable_text) {
+      entity_cold_t *cold = entity_cold(&state, entity);
+      igPushID_Int(cold->id);
 
-      if (is_selected) {
-        ImDrawList_AddRect(draw_list, entity->points.items[0],
-                           entity->points.items[2],
-                           igGetColorU32_Vec4((ImVec4){0.537, 0.706, 1, 1}),
-                           0.0, ImDrawFlags_None, 2.0);
-      }
-    } else if (entity->flags & entity_flag_editable_text) {
       ImVec2 cursor_pos;
       igGetCursorPos(&cursor_pos);
 
@@ -785,22 +3644,17 @@ static void frame(void) {
 
       igPushStyleColor_U32(ImGuiCol_FrameBg, 0);
 
-      igInputTextMultiline("##text", entity->content, 512, entity->dimension,
-                           ImGuiInputTextFlags_NoHorizontalScroll |
-                               ImGuiInputTextFlags_CallbackEdit,
-                           on_input_text_event, entity);
+      igInputTextMultiline(
+          "##text", text_pool_get(&state.text_pool, cold->text_offset),
+          cold->text_capacity, cold->dimension,
+          ImGuiInputTextFlags_NoHorizontalScroll |
+              ImGuiInputTextFlags_CallbackResize,
+          on_input_text_event, cold);
 
       igPopStyleColor(1);
 
-      if (is_selected) {
-        ImDrawList_AddRect(draw_list, entity->points.items[0],
-                           entity->points.items[2],
-                           igGetColorU32_Vec4((ImVec4){0.537, 0.706, 1, 1}),
-                           0.0, ImDrawFlags_None, 2.0);
-      }
+      igPopID();
     }
-
-    igPopID();
   }
 
   switch (state.current_tool) {
@@ -808,55 +3662,59 @@ static void frame(void) {
     break;
 
   case tool_select: {
-    if (state.is_mouse_down && state.is_prev_mouse_down &&
-        !state.is_moving_entities) {
-      ImDrawList_AddRect(draw_list, state.drag_start, io->MousePos, 0xFFFFFFFF,
-                         0.0f, ImDrawFlags_None, 1);
+    if (state.select_state == select_state_area_selecting &&
+        state.is_prev_mouse_down) {
+      canvas_instance_list_push_rect_outline(overlay, &state.drag_start,
+                                             &io->MousePos, 1, 0xFFFFFFFF);
     }
     break;
   }
 
   case tool_rectangle:
     if (state.is_mouse_down) {
-      ImDrawList_AddRectFilled(draw_list, state.drag_start, io->MousePos,
-                               igGetColorU32_Vec4(state.picked_color.Value),
-                               0.0f, ImDrawFlags_None);
+      canvas_instance_list_push_rect(overlay, &state.drag_start, &io->MousePos,
+                                     current_picked_color);
     }
     break;
 
   case tool_draw: {
     if (state.is_mouse_down && (state.last_mouse_pos.x != io->MousePos.x ||
                                 state.last_mouse_pos.y != io->MousePos.y)) {
-      *point_list_push(&state.points) = io->MousePos;
+      *point_chunk_list_push(&state.points) = io->MousePos;
     }
 
-    for (size_t i = 1; i < state.points.length; ++i) {
-      ImDrawList_AddLine(draw_list, state.points.items[i - 1],
-                         state.points.items[i], current_picked_color, 2);
-    }
+    canvas_instance_list_push_chunked_path(overlay, &state.points,
+                                           current_picked_color);
 
     break;
   }
 
   case tool_text:
     if (state.is_mouse_down && state.is_prev_mouse_down) {
-      ImDrawList_AddRect(draw_list, state.drag_start, io->MousePos, 0xFFFFFFFF,
-                         0.0f, ImDrawFlags_None, 1);
+      canvas_instance_list_push_rect_outline(overlay, &state.drag_start,
+                                             &io->MousePos, 1, 0xFFFFFFFF);
     }
   }
 
+  metrics_window();
+
   state.last_mouse_pos = io->MousePos;
 
   igEnd();
   igPopStyleVar(2);
 
+  canvas_renderer_upload(&state.renderer, &state.entities);
+
   sg_begin_pass(&(sg_pass){
       .action = state.pass_action,
-      .swapchain = sglue_swapchain(),
+      .swapchain = platform_swapchain(),
   });
+  canvas_renderer_draw(&state.renderer, &io->DisplaySize);
   simgui_render();
   sg_end_pass();
   sg_commit();
+
+  state.frame_allocs = allocs_since(&frame_start_allocs);
 }
 
 static void toolbox_window(void) {
@@ -921,24 +3779,928 @@ static void color_picker_window(void) {
   igEnd();
 }
 
+// appends canvas stats to the window shown by igShowMetricsWindow
+static void metrics_window(void) {
+  if (igBegin(METRICS_WINDOW_NAME, NULL, ImGuiWindowFlags_None)) {
+    igSeparator();
+    igText("Canvas: %d entities drawn, %d culled",
+           state.canvas_stats.drawn_entity_count,
+           state.canvas_stats.culled_entity_count);
+    igText("Canvas renderer: %zu of %zu instances drawn in %d draws",
+           state.renderer.drawn_instance_count,
+           state.renderer.committed.length, state.renderer.draw_call_count);
+
+    const arena_stats_t *frame_arena_stats = &state.frame_arena->stats;
+    igText("Frame arena: %zu bytes used, %zu peak, %zu pages",
+           frame_arena_stats->used_bytes, frame_arena_stats->peak_used_bytes,
+           frame_arena_stats->page_count);
+    igText("Heap: %zu allocations, %zu bytes last frame",
+           state.frame_allocs.count, state.frame_allocs.bytes);
+    igText("Point pool: %zu bytes in slabs, %zu free",
+           state.point_pool.slabs->stats.reserved_bytes,
+           state.point_pool.free_bytes);
+  }
+  igEnd();
+}
+
 static int on_input_text_event(ImGuiInputTextCallbackData *data) {
-  printf("input text event\n");
+  if (data->EventFlag == ImGuiInputTextFlags_CallbackResize) {
+    // the text outgrew its span in the text pool
+    entity_cold_t *cold = data->UserData;
+    data->Buf = entity_grow_text(&state, cold, data->BufSize);
+    data->BufSize = (int)cold->text_capacity;
+  }
+  return 0;
 }
 
 static void cleanup(void) {
+  canvas_renderer_shutdown(&state.renderer);
+  point_pool_free(&state.point_pool);
+  point_chunk_list_free(&state.points);
+  for (size_t i = 0; i < state.entities.length; ++i) {
+    segment_tree_free(&state.entities.cold[i].segments);
+  }
+  entity_store_free(&state.entities);
+  growable_string_free(&state.text_pool.storage);
+  arena_free(state.frame_arenas[0]);
+  arena_free(state.frame_arenas[1]);
   simgui_shutdown();
   sg_shutdown();
 }
 
+// ============================================================================
+// benchmark
+// ============================================================================
+
+// number of frames each scripted mouse drag lasts, excluding the frames in
+// which the mouse button is pressed and released
+#define BENCH_DRAG_FRAMES 30
+
+// distance (in px) between two consecutive points of a generated path
+#define BENCH_PATH_STEP 4
+
+// amplitude (in px) of the wave that scripted strokes follow, so that they are
+// not straight lines
+#define BENCH_STROKE_AMPLITUDE 20
+
+typedef enum {
+  bench_gesture_move_selection,
+  bench_gesture_area_select,
+  bench_gesture_draw,
+  bench_gesture_rectangle,
+  // hovers without pressing any button
+  bench_gesture_idle,
+  bench_gesture_count,
+} bench_gesture_kind_t;
+
+typedef struct {
+  bench_gesture_kind_t kind;
+  tool_t tool;
+  ImVec2 from;
+  ImVec2 to;
+  // frame within the gesture: 0 presses the mouse button,
+  // 1..BENCH_DRAG_FRAMES drags, and the frame after that releases
+  int frame;
+} bench_gesture_t;
+
+typedef struct {
+  unsigned int seed;
+  int path_count;
+  int path_point_count;
+  int rect_count;
+  int text_count;
+  int warmup_frame_count;
+  int frame_count;
+  float stroke_tolerance;
+  // the document is scattered over an area this many times as wide and as tall
+  // as the canvas, centered on it, so that most of it is off screen
+  int spread;
+  // fail as soon as a steady state frame allocates
+  bool is_alloc_strict;
+  // run the kernel microbenchmarks instead of the frame benchmark
+  bool is_kernel_bench;
+} bench_config_t;
+
+typedef struct {
+  bool is_enabled;
+  bool is_done;
+  bench_config_t config;
+
+  ImVec2 canvas_size;
+  int current_frame;
+  int gesture_count;
+  bench_gesture_t gesture;
+  // whether the upcoming frame is in a steady state, which must not allocate.
+  // these are idle frames and drag frames after the first one, which may
+  // still rebuild caches invalidated by the previous gesture, e.g. the bvh.
+  bool is_steady_frame;
+  int steady_frame_count;
+  int allocating_steady_frame_count;
+
+  double *frame_times;
+  // bytes uploaded by the canvas renderer over the recorded frames
+  size_t uploaded_bytes;
+} bench_t;
+
+// entity_t as the baseline declares it, before any of the benchmarked
+// changes: text is stored inline and the document is a linked list
+typedef struct bench_baseline_entity {
+  int id;
+  entity_flag_t flags;
+
+  point_list_t points;
+  ImVec2 dimension;
+  ImColor color;
+  char content[512];
+
+  struct bench_baseline_entity *next;
+  struct bench_baseline_entity *prev;
+} bench_baseline_entity_t;
+
+static bench_t bench = {
+    .config =
+        {
+            .seed = 1,
+            .path_count = 1000,
+            .path_point_count = 200,
+            .rect_count = 1000,
+            .text_count = 20,
+            .warmup_frame_count = 10,
+            .frame_count = 600,
+            .stroke_tolerance = STROKE_SIMPLIFY_TOLERANCE,
+            .spread = 1,
+        },
+};
+
+static uint64_t bench_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static float bench_rand_float(float max) {
+  return (float)rand() / (float)RAND_MAX * max;
+}
+
+static ImVec2 bench_rand_point(void) {
+  return (ImVec2){bench_rand_float(bench.canvas_size.x),
+                  bench_rand_float(bench.canvas_size.y)};
+}
+
+// returns a random point of the area the document is scattered over
+static ImVec2 bench_rand_document_point(void) {
+  const float spread = (float)bench.config.spread;
+  const ImVec2 point = {bench_rand_float(bench.canvas_size.x * spread),
+                        bench_rand_float(bench.canvas_size.y * spread)};
+  return (ImVec2){point.x - bench.canvas_size.x * (spread - 1) / 2,
+                  point.y - bench.canvas_size.y * (spread - 1) / 2};
+}
+
+static void bench_print_usage(const char *program) {
+  fprintf(stderr,
+          "usage: %s --bench [--seed n] [--paths n] [--path-points n] "
+          "[--rects n] [--texts n] [--spread n] [--warmup n] [--frames n] "
+          "[--stroke-tolerance px] [--strict-alloc] [--kernels]\n",
+          program);
+}
+
+// parses the command line. returns true if the benchmark is requested, and
+// exits the program if the arguments are malformed.
+static bool bench_parse_args(int argc, char *argv[]) {
+  bench_config_t *config = &bench.config;
+
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+
+    if (strcmp(arg, "--bench") == 0) {
+      bench.is_enabled = true;
+      continue;
+    }
+
+    if (strcmp(arg, "--strict-alloc") == 0) {
+      config->is_alloc_strict = true;
+      continue;
+    }
+
+    if (strcmp(arg, "--kernels") == 0) {
+      config->is_kernel_bench = true;
+      continue;
+    }
+
+    if (strcmp(arg, "--stroke-tolerance") == 0) {
+      if (i + 1 >= argc) {
+        bench_print_usage(argv[0]);
+        exit(1);
+      }
+
+      char *end;
+      const float parsed = strtof(argv[++i], &end);
+      if (*end != '\0' || parsed < 0) {
+        bench_print_usage(argv[0]);
+        exit(1);
+      }
+
+      config->stroke_tolerance = parsed;
+      continue;
+    }
+
+    int *value = NULL;
+    if (strcmp(arg, "--paths") == 0) {
+      value = &config->path_count;
+    } else if (strcmp(arg, "--path-points") == 0) {
+      value = &config->path_point_count;
+    } else if (strcmp(arg, "--rects") == 0) {
+      value = &config->rect_count;
+    } else if (strcmp(arg, "--texts") == 0) {
+      value = &config->text_count;
+    } else if (strcmp(arg, "--spread") == 0) {
+      value = &config->spread;
+    } else if (strcmp(arg, "--warmup") == 0) {
+      value = &config->warmup_frame_count;
+    } else if (strcmp(arg, "--frames") == 0) {
+      value = &config->frame_count;
+    } else if (strcmp(arg, "--seed") != 0) {
+      bench_print_usage(argv[0]);
+      exit(1);
+    }
+
+    if (i + 1 >= argc) {
+      bench_print_usage(argv[0]);
+      exit(1);
+    }
+
+    char *end;
+    const long parsed = strtol(argv[++i], &end, 10);
+    if (*end != '\0' || parsed < 0) {
+      bench_print_usage(argv[0]);
+      exit(1);
+    }
+
+    if (value) {
+      *value = (int)parsed;
+    } else {
+      config->seed = (unsigned int)parsed;
+    }
+  }
+
+  if (config->path_point_count < 2) {
+    config->path_point_count = 2;
+  }
+  if (config->frame_count < 1) {
+    config->frame_count = 1;
+  }
+  if (config->spread < 1) {
+    config->spread = 1;
+  }
+
+  return bench.is_enabled;
+}
+
+static void bench_push_quad(entity_t *entity, const ImVec2 *top_left,
+                            const ImVec2 *bottom_right) {
+  point_pool_t *pool = &state.point_pool;
+  *point_pool_push(pool, &entity->points) = *top_left;
+  *point_pool_push(pool, &entity->points) =
+      (ImVec2){bottom_right->x, top_left->y};
+  *point_pool_push(pool, &entity->points) = *bottom_right;
+  *point_pool_push(pool, &entity->points) =
+      (ImVec2){top_left->x, bottom_right->y};
+}
+
+static void bench_populate(void) {
+  const bench_config_t *config = &bench.config;
+
+  for (int i = 0; i < config->path_count; ++i) {
+    entity_t *entity = entity_alloc(&state, config->path_point_count + 1);
+    entity->flags = entity_flag_path;
+    entity->color = igColorConvertFloat4ToU32(state.picked_color.Value);
+
+    ImVec2 point = bench_rand_document_point();
+    for (int j = 0; j < config->path_point_count; ++j) {
+      *point_pool_push(&state.point_pool, &entity->points) = point;
+      const float angle = bench_rand_float(2 * M_PI);
+      point.x += cosf(angle) * BENCH_PATH_STEP;
+      point.y += sinf(angle) * BENCH_PATH_STEP;
+    }
+
+    push_entity(&state, entity);
+  }
+
+  for (int i = 0; i < config->rect_count; ++i) {
+    entity_t *entity = entity_alloc(&state, 4);
+    entity->flags = entity_flag_rect;
+    entity->color = igColorConvertFloat4ToU32(state.picked_color.Value);
+
+    const ImVec2 top_left = bench_rand_document_point();
+    const ImVec2 bottom_right = {top_left.x + 25 + bench_rand_float(100),
+                                 top_left.y + 25 + bench_rand_float(100)};
+    bench_push_quad(entity, &top_left, &bottom_right);
+
+    push_entity(&state, entity);
+  }
+
+  for (int i = 0; i < config->text_count; ++i) {
+    entity_t *entity = entity_alloc(&state, 4);
+    entity->flags = entity_flag_editable_text;
+    entity->color = igColorConvertFloat4ToU32(state.picked_color.Value);
+    entity_init_text(&state, entity, "Text");
+
+    const ImVec2 top_left = bench_rand_document_point();
+    const ImVec2 bottom_right = {top_left.x + 120, top_left.y + 40};
+    entity_cold_t *cold = entity_cold(&state, entity);
+    cold->dimension.x = bottom_right.x - top_left.x;
+    cold->dimension.y = bottom_right.y - top_left.y;
+    bench_push_quad(entity, &top_left, &bottom_right);
+
+    push_entity(&state, entity);
+  }
+}
+
+// picks a random point on a random entity, so that the gesture starting there
+// grabs that entity.
+static ImVec2 bench_rand_entity_point(void) {
+  if (state.entities.length == 0) {
+    return bench_rand_point();
+  }
+
+  const entity_t *entity =
+      state.entities.items + (size_t)rand() % state.entities.length;
+  return entity->points.items[(size_t)rand() % entity->points.length];
+}
+
+// picks a random point that is not on any entity, so that the gesture starting
+// there begins an area selection. on documents too dense to find one, a point
+// left of the canvas is used instead.
+static ImVec2 bench_rand_empty_point(void) {
+  for (int i = 0; i < 64; ++i) {
+    const ImVec2 point = bench_rand_point();
+    if (find_entity_near_mouse(&state, &point) == NULL) {
+      return point;
+    }
+  }
+
+  ImVec2 point = {-SELECT_THRESHOLD, bench_rand_point().y};
+  while (find_entity_near_mouse(&state, &point) != NULL) {
+    point.x -= SELECT_THRESHOLD;
+  }
+  return point;
+}
+
+static void bench_next_gesture(void) {
+  bench_gesture_t *gesture = &bench.gesture;
+
+  gesture->kind = bench.gesture_count++ % bench_gesture_count;
+  gesture->frame = 0;
+
+  switch (gesture->kind) {
+  default:
+  case bench_gesture_move_selection:
+    gesture->tool = tool_select;
+    gesture->from = bench_rand_entity_point();
+    break;
+
+  case bench_gesture_area_select:
+    gesture->tool = tool_select;
+    gesture->from = bench_rand_empty_point();
+    break;
+
+  case bench_gesture_draw:
+    gesture->tool = tool_draw;
+    gesture->from = bench_rand_point();
+    break;
+
+  case bench_gesture_rectangle:
+    gesture->tool = tool_rectangle;
+    gesture->from = bench_rand_point();
+    break;
+
+  case bench_gesture_idle:
+    gesture->tool = tool_select;
+    gesture->from = bench_rand_point();
+    break;
+  }
+
+  gesture->to = (ImVec2){gesture->from.x - 100 + bench_rand_float(200),
+                         gesture->from.y - 100 + bench_rand_float(200)};
+}
+
+// queues the synthetic mouse input for the upcoming frame. the events are
+// picked up by imgui when frame() starts a new imgui frame.
+static void bench_feed_input(void) {
+  ImGuiIO *io = igGetIO();
+
+  bench.is_steady_frame = false;
+  if (bench.current_frame < bench.config.warmup_frame_count) {
+    return;
+  }
+
+  bench_gesture_t *gesture = &bench.gesture;
+
+  if (gesture->frame > BENCH_DRAG_FRAMES + 1) {
+    bench_next_gesture();
+  }
+
+  const bool is_idle = gesture->kind == bench_gesture_idle;
+  bench.is_steady_frame =
+      is_idle || (gesture->frame >= 2 && gesture->frame <= BENCH_DRAG_FRAMES);
+
+  if (gesture->frame == 0) {
+    state.current_tool = gesture->tool;
+    ImGuiIO_AddMousePosEvent(io, gesture->from.x, gesture->from.y);
+    ImGuiIO_AddMouseButtonEvent(io, ImGuiMouseButton_Left, !is_idle);
+  } else if (gesture->frame <= BENCH_DRAG_FRAMES) {
+    const float t = (float)gesture->frame / BENCH_DRAG_FRAMES;
+    ImVec2 pos = {gesture->from.x + (gesture->to.x - gesture->from.x) * t,
+                  gesture->from.y + (gesture->to.y - gesture->from.y) * t};
+    if (gesture->kind == bench_gesture_draw) {
+      pos.y += sinf(t * 2 * (float)M_PI) * BENCH_STROKE_AMPLITUDE;
+    }
+    ImGuiIO_AddMousePosEvent(io, pos.x, pos.y);
+  } else if (!is_idle) {
+    ImGuiIO_AddMouseButtonEvent(io, ImGuiMouseButton_Left, false);
+  }
+
+  ++gesture->frame;
+}
+
+static int bench_compare_frame_times(const void *a, const void *b) {
+  const double lhs = *(const double *)a;
+  const double rhs = *(const double *)b;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+// nearest-rank percentile of a sorted list of frame times
+static double bench_percentile(const double *sorted, int count, double p) {
+  int rank = (int)ceil(p / 100.0 * count);
+  if (rank < 1) {
+    rank = 1;
+  }
+  return sorted[rank - 1];
+}
+
+static void bench_report(void) {
+  const bench_config_t *config = &bench.config;
+  const int recorded = bench.current_frame - config->warmup_frame_count;
+
+  if (recorded <= 0) {
+    printf("bench: no frames recorded\n");
+    return;
+  }
+
+  qsort(bench.frame_times, recorded, sizeof(double),
+        bench_compare_frame_times);
+
+  double total = 0;
+  for (int i = 0; i < recorded; ++i) {
+    total += bench.frame_times[i];
+  }
+
+  printf("bench: seed %u, %d paths x %d points, %d rects, %d texts, spread "
+         "over %dx the canvas\n",
+         config->seed, config->path_count, config->path_point_count,
+         config->rect_count, config->text_count, config->spread);
+  printf("bench: %d frames (%d warmup), %d gestures, %zu entities at exit\n",
+         recorded, config->warmup_frame_count, bench.gesture_count,
+         state.entities.length);
+  printf("bench: frame() ms p50 %.3f p95 %.3f p99 %.3f max %.3f mean %.3f\n",
+         bench_percentile(bench.frame_times, recorded, 50),
+         bench_percentile(bench.frame_times, recorded, 95),
+         bench_percentile(bench.frame_times, recorded, 99),
+         bench.frame_times[recorded - 1], total / recorded);
+  printf("bench: last frame drew %d entities, culled %d\n",
+         state.canvas_stats.drawn_entity_count,
+         state.canvas_stats.culled_entity_count);
+  const size_t entity_count = state.entities.length;
+  printf("bench: entity footprint: %zu B in the baseline, %zu B hot + %zu B "
+         "cold now\n",
+         sizeof(bench_baseline_entity_t), sizeof(entity_t),
+         sizeof(entity_cold_t));
+  printf("bench: document entities: %.1f KiB in the baseline, %.1f KiB hot + "
+         "%.1f KiB cold + %.1f KiB text now\n",
+         entity_count * sizeof(bench_baseline_entity_t) / 1024.0,
+         entity_count * sizeof(entity_t) / 1024.0,
+         entity_count * sizeof(entity_cold_t) / 1024.0,
+         state.text_pool.storage.length / 1024.0);
+
+  printf("bench: %d of %d steady state frames allocated, %zu allocations "
+         "(%zu bytes) in total\n",
+         bench.allocating_steady_frame_count, bench.steady_frame_count,
+         total_allocs.count, total_allocs.bytes);
+  printf("bench: point pool: %.1f KiB in slabs, %.1f KiB free\n",
+         state.point_pool.slabs->stats.reserved_bytes / 1024.0,
+         state.point_pool.free_bytes / 1024.0);
+  printf("bench: frame arenas peaked at %zu and %zu bytes\n",
+         state.frame_arenas[0]->stats.peak_used_bytes,
+         state.frame_arenas[1]->stats.peak_used_bytes);
+
+  const stroke_stats_t *stroke_stats = &state.stroke_stats;
+  if (stroke_stats->drawn_point_count > 0) {
+    printf("bench: strokes simplified to %g px kept %zu of %zu points "
+           "(%.1f%%)\n",
+           state.stroke_tolerance, stroke_stats->kept_point_count,
+           stroke_stats->drawn_point_count,
+           100.0 * stroke_stats->kept_point_count /
+               stroke_stats->drawn_point_count);
+  }
+  printf("bench: canvas renderer: %zu committed instances, %zu overlay "
+         "instances, %.3f MiB uploaded per frame\n",
+         state.renderer.committed.length, state.renderer.overlay.length,
+         (double)bench.uploaded_bytes / recorded / (1024.0 * 1024.0));
+  printf("bench: canvas renderer: last frame drew %zu instances in %d draws\n",
+         state.renderer.drawn_instance_count, state.renderer.draw_call_count);
+}
+
+static void bench_init(void) {
+  init();
+
+  const simgui_frame_desc_t frame_desc = platform_frame_desc();
+  bench.canvas_size.x = frame_desc.width / frame_desc.dpi_scale;
+  bench.canvas_size.y = frame_desc.height / frame_desc.dpi_scale;
+
+  state.stroke_tolerance = bench.config.stroke_tolerance;
+
+  bench.frame_times = mem_alloc(sizeof(double) * bench.config.frame_count);
+  bench.current_frame = 0;
+  bench.gesture_count = 0;
+  // forces the first gesture to be picked on the first recorded frame
+  bench.gesture.frame = BENCH_DRAG_FRAMES + 2;
+
+  srand(bench.config.seed);
+  bench_populate();
+}
+
+static void bench_frame(void) {
+  if (bench.is_done) {
+    return;
+  }
+
+  bench_feed_input();
+
+  const uint64_t start = bench_now_ns();
+  frame();
+  const uint64_t end = bench_now_ns();
+
+  const int recorded_frame =
+      bench.current_frame - bench.config.warmup_frame_count;
+  if (recorded_frame >= 0) {
+    bench.frame_times[recorded_frame] = (double)(end - start) / 1e6;
+    bench.uploaded_bytes += state.renderer.uploaded_bytes;
+  }
+
+  if (bench.is_steady_frame) {
+    ++bench.steady_frame_count;
+    if (state.frame_allocs.count > 0) {
+      ++bench.allocating_steady_frame_count;
+      if (bench.config.is_alloc_strict) {
+        fprintf(stderr,
+                "bench: steady state frame %d made %zu allocations (%zu "
+                "bytes)\n",
+                recorded_frame, state.frame_allocs.count,
+                state.frame_allocs.bytes);
+        exit(1);
+      }
+    }
+  }
+
+  ++bench.current_frame;
+  if (recorded_frame + 1 >= bench.config.frame_count) {
+    bench.is_done = true;
+#if !defined(IMDRAW_HEADLESS)
+    sapp_request_quit();
+#endif
+  }
+}
+
+static void bench_cleanup(void) {
+  bench_report();
+  mem_free(bench.frame_times);
+  cleanup();
+}
+
+// number of points that the kernel microbenchmarks run over
+#define BENCH_KERNEL_POINT_COUNT (1000 * 1000)
+
+// number of times each kernel is run, each time with another query
+#define BENCH_KERNEL_RUN_COUNT 32
+
+// results of the kernels that are not otherwise looked at end up here, so that
+// the compiler cannot drop the calls
+static volatile float bench_kernel_sink;
+
+typedef float (*bench_segments_kernel_t)(const ImVec2 *points,
+                                         size_t segment_count,
+                                         const ImVec2 *point,
+                                         float stop_distance_sqr);
+
+// times every version of segments_distance_sqr the cpu supports over the
+// whole of points, and checks that they agree with the scalar one
+static void bench_segments_kernels(const ImVec2 *points, size_t count) {
+  const struct {
+    simd_level_t level;
+    bench_segments_kernel_t kernel;
+  } kernels[] = {
+      {simd_level_scalar, segments_distance_sqr_scalar},
+#if defined(IMDRAW_X86)
+      {simd_level_sse2, segments_distance_sqr_sse2},
+      {simd_level_avx2, segments_distance_sqr_avx2},
+#endif
+  };
+
+  ImVec2 queries[BENCH_KERNEL_RUN_COUNT];
+  for (int i = 0; i < BENCH_KERNEL_RUN_COUNT; ++i) {
+    queries[i] = bench_rand_point();
+  }
+
+  float expected[BENCH_KERNEL_RUN_COUNT];
+  double scalar_ns = 0;
+  for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k) {
+    if (kernels[k].level > simd_level()) {
+      continue;
+    }
+
+    float results[BENCH_KERNEL_RUN_COUNT];
+    const uint64_t start = bench_now_ns();
+    for (int i = 0; i < BENCH_KERNEL_RUN_COUNT; ++i) {
+      // a stop distance of 0 makes the kernels visit every segment
+      results[i] = kernels[k].kernel(points, count - 1, queries + i, 0);
+    }
+    const double ns = (double)(bench_now_ns() - start) /
+                      ((double)BENCH_KERNEL_RUN_COUNT * (count - 1));
+
+    for (int i = 0; i < BENCH_KERNEL_RUN_COUNT; ++i) {
+      bench_kernel_sink = results[i];
+      if (k == 0) {
+        expected[i] = results[i];
+      } else if (fabsf(results[i] - expected[i]) >
+                 1e-5f * fmaxf(expected[i], 1)) {
+        fprintf(stderr,
+                "bench: segments_distance_sqr %s returned %g instead of %g\n",
+                simd_level_names[kernels[k].level], results[i], expected[i]);
+        exit(1);
+      }
+    }
+    if (k == 0) {
+      scalar_ns = ns;
+    }
+
+    printf("bench: segments_distance_sqr %-6s %.3f ns per segment, %.2fx "
+           "scalar\n",
+           simd_level_names[kernels[k].level], ns, scalar_ns / ns);
+  }
+}
+
+// size (in px) of the areas that points_any_in_area is timed with. most of
+// them miss the points, so that the kernels visit every point.
+#define BENCH_KERNEL_AREA_SIZE 2
+
+typedef bool (*bench_area_kernel_t)(const ImVec2 *points, size_t count,
+                                    const aabb_t *area);
+
+// times every version of points_any_in_area the cpu supports over the whole
+// of points, and checks that they agree with the scalar one
+static void bench_area_kernels(const ImVec2 *points, size_t count) {
+  const struct {
+    simd_level_t level;
+    bench_area_kernel_t kernel;
+  } kernels[] = {
+      {simd_level_scalar, points_any_in_area_scalar},
+#if defined(IMDRAW_X86)
+      {simd_level_sse2, points_any_in_area_sse2},
+      {simd_level_avx2, points_any_in_area_avx2},
+#endif
+  };
+
+  aabb_t areas[BENCH_KERNEL_RUN_COUNT];
+  for (int i = 0; i < BENCH_KERNEL_RUN_COUNT; ++i) {
+    const ImVec2 corner = bench_rand_point();
+    const ImVec2 opposite = {corner.x + BENCH_KERNEL_AREA_SIZE,
+                             corner.y + BENCH_KERNEL_AREA_SIZE};
+    areas[i] = aabb_from_corners(&corner, &opposite);
+  }
+
+  bool expected[BENCH_KERNEL_RUN_COUNT];
+  double scalar_ns = 0;
+  int hit_count = 0;
+  for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k) {
+    if (kernels[k].level > simd_level()) {
+      continue;
+    }
+
+    bool results[BENCH_KERNEL_RUN_COUNT];
+    const uint64_t start = bench_now_ns();
+    for (int i = 0; i < BENCH_KERNEL_RUN_COUNT; ++i) {
+      results[i] = kernels[k].kernel(points, count, areas + i);
+    }
+    const double ns = (double)(bench_now_ns() - start) /
+                      ((double)BENCH_KERNEL_RUN_COUNT * count);
+
+    for (int i = 0; i < BENCH_KERNEL_RUN_COUNT; ++i) {
+      bench_kernel_sink = results[i];
+      if (k == 0) {
+        expected[i] = results[i];
+        hit_count += results[i];
+      } else if (results[i] != expected[i]) {
+        fprintf(stderr, "bench: points_any_in_area %s returned %d instead of "
+                        "%d\n",
+                simd_level_names[kernels[k].level], results[i], expected[i]);
+        exit(1);
+      }
+    }
+    if (k == 0) {
+      scalar_ns = ns;
+    }
+
+    printf("bench: points_any_in_area %-6s %.3f ns per point, %.2fx scalar "
+           "(%d of %d areas hit)\n",
+           simd_level_names[kernels[k].level], ns, scalar_ns / ns, hit_count,
+           BENCH_KERNEL_RUN_COUNT);
+  }
+}
+
+typedef void (*bench_translate_kernel_t)(ImVec2 *points, size_t count,
+                                         const ImVec2 *delta);
+
+// times every version of points_translate the cpu supports, each moving its
+// own copy of points by the same deltas, and checks that the copies end up
+// the same as the scalar one
+static void bench_translate_kernels(const ImVec2 *points, size_t count) {
+  const struct {
+    simd_level_t level;
+    bench_translate_kernel_t kernel;
+  } kernels[] = {
+      {simd_level_scalar, points_translate_scalar},
+#if defined(IMDRAW_X86)
+      {simd_level_sse2, points_translate_sse2},
+      {simd_level_avx2, points_translate_avx2},
+#endif
+  };
+
+  ImVec2 deltas[BENCH_KERNEL_RUN_COUNT];
+  for (int i = 0; i < BENCH_KERNEL_RUN_COUNT; ++i) {
+    deltas[i] = (ImVec2){bench_rand_float(2) - 1, bench_rand_float(2) - 1};
+  }
+
+  ImVec2 *expected = mem_alloc(sizeof(ImVec2) * count);
+  ImVec2 *moved = mem_alloc(sizeof(ImVec2) * count);
+  double scalar_ns = 0;
+  for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k) {
+    if (kernels[k].level > simd_level()) {
+      continue;
+    }
+
+    ImVec2 *result = k == 0 ? expected : moved;
+    memcpy(result, points, sizeof(ImVec2) * count);
+    const uint64_t start = bench_now_ns();
+    for (int i = 0; i < BENCH_KERNEL_RUN_COUNT; ++i) {
+      kernels[k].kernel(result, count, deltas + i);
+    }
+    const double ns = (double)(bench_now_ns() - start) /
+                      ((double)BENCH_KERNEL_RUN_COUNT * count);
+
+    if (k == 0) {
+      scalar_ns = ns;
+    } else if (memcmp(result, expected, sizeof(ImVec2) * count) != 0) {
+      fprintf(stderr, "bench: points_translate %s moved points differently\n",
+              simd_level_names[kernels[k].level]);
+      exit(1);
+    }
+
+    printf("bench: points_translate %-6s %.3f ns per point, %.2fx scalar\n",
+           simd_level_names[kernels[k].level], ns, scalar_ns / ns);
+  }
+
+  mem_free(moved);
+  mem_free(expected);
+}
+
+// times hit tests against the whole of points through a segment tree, and
+// by scanning every segment, for points near the path half of the time and
+// anywhere on the canvas otherwise, and checks that both agree
+static void bench_segment_tree(const ImVec2 *points, size_t count) {
+  ImVec2 queries[BENCH_KERNEL_RUN_COUNT];
+  for (int i = 0; i < BENCH_KERNEL_RUN_COUNT; ++i) {
+    if (i % 2 == 0) {
+      const ImVec2 *near = points + rand() % count;
+      queries[i] = (ImVec2){near->x + bench_rand_float(8) - 4,
+                            near->y + bench_rand_float(8) - 4};
+    } else {
+      queries[i] = bench_rand_point();
+    }
+  }
+
+  segment_tree_t tree = {0};
+  uint64_t start = bench_now_ns();
+  segment_tree_build(&tree, points, count);
+  const double build_ms = (double)(bench_now_ns() - start) / 1e6;
+
+  bool expected[BENCH_KERNEL_RUN_COUNT];
+  start = bench_now_ns();
+  for (int i = 0; i < BENCH_KERNEL_RUN_COUNT; ++i) {
+    expected[i] = segments_distance_sqr(points, count - 1, queries + i,
+                                        SELECT_THRESHOLD) <= SELECT_THRESHOLD;
+  }
+  const double scan_ns =
+      (double)(bench_now_ns() - start) / BENCH_KERNEL_RUN_COUNT;
+
+  bool results[BENCH_KERNEL_RUN_COUNT];
+  start = bench_now_ns();
+  for (int i = 0; i < BENCH_KERNEL_RUN_COUNT; ++i) {
+    results[i] = segment_tree_is_near(&tree, points, count, queries + i,
+                                      SELECT_THRESHOLD);
+  }
+  const double tree_ns =
+      (double)(bench_now_ns() - start) / BENCH_KERNEL_RUN_COUNT;
+
+  int hit_count = 0;
+  for (int i = 0; i < BENCH_KERNEL_RUN_COUNT; ++i) {
+    if (results[i] != expected[i]) {
+      fprintf(stderr, "bench: segment_tree_is_near returned %d instead of "
+                      "%d\n",
+              results[i], expected[i]);
+      exit(1);
+    }
+    hit_count += results[i];
+  }
+
+  printf("bench: segment tree of %u runs built in %.3f ms, hit test %.0f ns "
+         "against %.0f ns scanning every segment (%d of %d points hit)\n",
+         tree.run_count, build_ms, tree_ns, scan_ns, hit_count,
+         BENCH_KERNEL_RUN_COUNT);
+
+  segment_tree_free(&tree);
+}
+
+// runs the kernels over a random walk of BENCH_KERNEL_POINT_COUNT points, as
+// drawn by a very long stroke
+static void bench_kernels(void) {
+  srand(bench.config.seed);
+  bench.canvas_size = (ImVec2){1280, 720};
+
+  const size_t count = BENCH_KERNEL_POINT_COUNT;
+  ImVec2 *points = mem_alloc(sizeof(ImVec2) * count);
+  ImVec2 point = bench_rand_point();
+  for (size_t i = 0; i < count; ++i) {
+    points[i] = point;
+    const float angle = bench_rand_float(2 * M_PI);
+    point.x += cosf(angle) * BENCH_PATH_STEP;
+    point.y += sinf(angle) * BENCH_PATH_STEP;
+  }
+
+  printf("bench: kernels over %zu points, %s picked at runtime\n", count,
+         simd_level_names[simd_level()]);
+  bench_segments_kernels(points, count);
+  bench_area_kernels(points, count);
+  bench_translate_kernels(points, count);
+  bench_segment_tree(points, count);
+
+  mem_free(points);
+}
+
+// ============================================================================
+// entry point
+// ============================================================================
+
+#if defined(IMDRAW_HEADLESS)
+
+int main(int argc, char *argv[]) {
+  if (!bench_parse_args(argc, argv)) {
+    // there is nothing to show without a window
+    bench_print_usage(argv[0]);
+    return 1;
+  }
+
+  if (bench.config.is_kernel_bench) {
+    bench_kernels();
+    return 0;
+  }
+
+  bench_init();
+  while (!bench.is_done) {
+    bench_frame();
+  }
+  bench_cleanup();
+
+  return 0;
+}
+
+#else
+
 static void event(const sapp_event *event) { simgui_handle_event(event); }
 
 sapp_desc sokol_main(int argc, char *argv[]) {
   srand(time(NULL));
 
+  const bool is_bench = bench_parse_args(argc, argv);
+  if (is_bench && bench.config.is_kernel_bench) {
+    // the kernels need no window
+    bench_kernels();
+    exit(0);
+  }
+
   return (sapp_desc){
-      .init_cb = init,
-      .frame_cb = frame,
-      .cleanup_cb = cleanup,
+      .init_cb = is_bench ? bench_init : init,
+      .frame_cb = is_bench ? bench_frame : frame,
+      .cleanup_cb = is_bench ? bench_cleanup : cleanup,
       .event_cb = event,
       .logger.func = slog_func,
       .width = 640,
@@ -948,3 +4710,5 @@ sapp_desc sokol_main(int argc, char *argv[]) {
       .high_dpi = true,
   };
 }
+
+#endif